@@ -6,6 +6,10 @@
 #include "include/engine-core/helpers.h"
 #include "include/engine-core/init.h"
 #include "include/engine-core/move.h"
+#include "include/engine-core/movelist.h"
+#include "include/engine-core/movepicker.h"
+#include "include/engine-core/nnue.h"
+#include "include/engine-core/pawns.h"
 #include "include/engine-core/perft.h"
 #include "include/engine-core/pq.h"
 #include "include/engine-core/prettyprint.h"
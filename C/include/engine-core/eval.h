@@ -2,6 +2,7 @@
 #define __EVAL_H__
 
 #include "include/engine-core/types.h"
+#include "include/engine-core/pawns.h"
 
 #define PIECE_COLOR(p) ((p)>>3)
 #define FLIP(sq) ((sq)^56)
@@ -12,6 +13,9 @@
 #define ROOKVALUE 500
 #define QUEENVALUE 900
 
+#define LAZY_EVAL_MARGIN 150        // centipawns the estimate has to be outside the window to skip the full eval
+#define EVAL_CACHE_SIZE (1 << 16)   // entries (power of two, at most 1 << 16), 512KB per thread
+
 /* pawn position values */
 extern int PAWN_POSITION_VALUE[64];
 /* knight position values */
@@ -27,11 +31,45 @@ extern int KING_POSITION_VALUE[64];
 /* 1-to-1 mapping from pieces to their material value */
 extern const int MATERIAL_VALUE[16];
 
+/* game phase increment per piece */
+extern int gamephaseInc[14];
+/* midgame PeSTO value per piece and square (material and position) */
+extern int mg_table[14][64];
+/* endgame PeSTO value per piece and square (material and position) */
+extern int eg_table[14][64];
+
+/* cache of static evaluations (one per search thread, so no locking is needed) */
+/* every entry packs the upper 48 bits of the zobrist key with the 16 bit evaluation into one word */
+typedef struct _evalcache_t {
+    uint64_t* entries;
+    uint64_t probes;                /* number of lookups */
+    uint64_t hits;                  /* number of lookups which found the evaluation */
+} evalcache_t;
+
 /* ------------------------------------------------------------------------------------------------ */
 /* functions for simple evaluation                                                       */
 /* ------------------------------------------------------------------------------------------------ */
 
-/* returns simple evaluation (material and positional difference) */
-int eval_board(board_t *board);
+/* recomputes the incrementally updated PeSTO scores and game phase of a board from scratch */
+void calculate_eval_state(board_t *board);
+/* returns the evaluation of the board (network if loaded, else material, positional difference and pawn
+   structure, cached in the pawn table which may be NULL) */
+int eval_board(board_t *board, pawntable_t *pawn_table);
+/* returns the material and positional part of the PeSTO evaluation only (a cheap estimate of eval_board
+   if no network is loaded) */
+int estimate_eval_board(board_t *board);
+
+/* ------------------------------------------------------------------------------------------------ */
+/* functions for caching evaluations                                                                */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* allocates an (empty) evaluation cache */
+evalcache_t init_eval_cache(void);
+/* frees the memory of an evaluation cache */
+void free_eval_cache(evalcache_t *cache);
+/* returns 1 (and the evaluation) if the evaluation of the board is cached */
+int probe_eval_cache(evalcache_t *cache, board_t *board, int *eval);
+/* stores the evaluation of the board in the cache (replacing whatever was stored in its entry) */
+void store_eval_cache(evalcache_t *cache, board_t *board, int eval);
 
 #endif
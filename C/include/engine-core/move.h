@@ -1,7 +1,7 @@
 #ifndef __MOVE_H__
 #define __MOVE_H__
 
-#include "include/engine-core/pq.h"
+#include "include/engine-core/movelist.h"
 #include "include/engine-core/types.h"
 
 /* ------------------------------------------------------------------------------------------------ */
@@ -9,9 +9,15 @@
 /* ------------------------------------------------------------------------------------------------ */
 
 /* generates all moves for a given board */
-void generate_moves(board_t* board, maxpq_t* movelst);
-/* generates tactical moves for a given board */
-void generate_tactical_moves(board_t* board, maxpq_t* movelst);
+void generate_moves(board_t* board, movelist_t* movelst);
+/* generates tactical moves (captures and promotions) for a given board */
+void generate_tactical_moves(board_t* board, movelist_t* movelst);
+/* generates quiet moves (all moves which are not tactical) for a given board */
+void generate_quiet_moves(board_t* board, movelist_t* movelst);
+/* generates all moves for a given board whose player at turn is in check */
+void generate_evasions(board_t* board, movelist_t* movelst);
+/* generates quiet moves giving check (castling excluded) for a given board */
+void generate_quiet_checks(board_t* board, movelist_t* movelst);
 /* executes a given move on a given board */
 void do_move(board_t* board, move_t move);
 /* undoes a given move on a given board */
@@ -20,6 +26,8 @@ void undo_move(board_t* board, move_t move);
 void do_null_move(board_t* board);
 /* undoes a null move */
 void undo_null_move(board_t* board);
+/* calculates the zobrist hash of the board after a given move, without executing it */
+uint64_t hash_after_move(board_t* board, move_t move);
 
 
 /* ------------------------------------------------------------------------------------------------ */
@@ -36,6 +44,8 @@ int is_same_move(move_t move1, move_t move2);
 int is_in_check_fast(board_t* board);
 /* checks if current player is in check, i.e. can only make check evading moves */
 int is_in_check(board_t* board);
+/* checks if a quiet move is legal in the current position - only use in right situations, see WARNING */
+int is_legal_quiet_move(board_t* board, move_t move);
 
 
 /* ------------------------------------------------------------------------------------------------ */
@@ -0,0 +1,51 @@
+#ifndef __MOVELIST_H__
+#define __MOVELIST_H__
+
+#include "include/engine-core/types.h"
+
+#define MOVELIST_SIZE 256   // 218 legal moves at most
+
+/* ------------------------------------------------------------------------------------------------ */
+/* structs and functions for managing move lists                                                    */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* flat move list, the moves are ordered lazily (by value) while picking them */
+typedef struct _movelist_t {
+    int nr_elem;                    /* number of moves in the list */
+    int next;                       /* index of the next move to pick, moves before it are already picked */
+    move_t array[MOVELIST_SIZE];    /* the moves (only the first nr_elem are valid, the rest is NOT cleared) */
+} movelist_t;
+
+/* initializes a given move list (in constant time) */
+static inline void init_movelist(movelist_t* lst) {
+    lst->nr_elem = 0;
+    lst->next = 0;
+}
+
+/* appends a move to the move list */
+static inline void add_move(movelist_t* lst, move_t move) {
+    lst->array[lst->nr_elem++] = move;
+}
+
+/* returns true if there are moves left to pick */
+static inline int has_next(movelist_t* lst) {
+    return lst->next < lst->nr_elem;
+}
+
+/* returns the not yet picked move with highest value (one step of a selection sort) */
+static inline move_t pick_next(movelist_t* lst) {
+    int best = lst->next;
+    for (int i = lst->next + 1; i < lst->nr_elem; i++) {
+        if (lst->array[i].value > lst->array[best].value) best = i;
+    }
+
+    move_t move = lst->array[best];
+    lst->array[best] = lst->array[lst->next];
+    lst->array[lst->next++] = move;
+    return move;
+}
+
+/* prints a given move list (in memory order) */
+void print_movelist(movelist_t* lst);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef __MOVEPICKER_H__
+#define __MOVEPICKER_H__
+
+#include "include/engine-core/types.h"
+#include "include/engine-core/movelist.h"
+
+#define NR_KILLERS 2                        // killer moves per ply
+#define HISTORY_MAX 16384                   // history scores stay within [-HISTORY_MAX, HISTORY_MAX]
+#define COUNTER_MOVE_BONUS (HISTORY_MAX / 2) // added to the history score of the counter move
+
+/* butterfly history table, indexed by player, from and to square */
+typedef int16_t history_t[2][64][64];
+
+/* ------------------------------------------------------------------------------------------------ */
+/* structs and functions for staged move generation                                                 */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* stages of the move picker (in the order they are visited) */
+typedef enum _pickstage_t {
+    STAGE_TT_MOVE,              /* try the move of the transposition table (nothing generated yet) */
+    STAGE_GEN_TACTICAL,         /* generate captures and promotions */
+    STAGE_TACTICAL,             /* try captures and promotions (MVV-LVA order) */
+    STAGE_KILLERS,              /* try the killer moves of the current ply */
+    STAGE_GEN_QUIET,            /* generate the remaining (quiet) moves */
+    STAGE_QUIET,                /* try quiet moves (history and counter move order) */
+    STAGE_DONE
+} pickstage_t;
+
+/* move picker struct, handing out the moves of a position one at a time and generating them lazily */
+typedef struct _movepicker_t {
+    board_t* board;                         /* the position to pick moves for */
+    pickstage_t stage;                      /* the current stage */
+
+    move_t tt_move;                         /* move of the transposition table (if has_tt_move) */
+    int has_tt_move;
+    move_t killers[NR_KILLERS];             /* killer moves of the current ply (empty slots are {0,0,0,0}) */
+    int killer_idx;                         /* next killer move to try */
+    int killers_tried;                      /* bitmask of killer moves handed out (i.e. legal ones) */
+    move_t counter_move;                    /* quiet move refuting the previous move ({0,0,0,0} if none) */
+    history_t* history;                     /* history table to order quiet moves by (may be NULL) */
+
+    bitboard_t checkers;                    /* checkers, pinned pieces and attacked squares of the board */
+    bitboard_t pinned;                      /* (saved after generating the tactical moves, since searching */
+    bitboard_t attackmap;                   /* them overwrites the ones on the board) */
+
+    movelist_t movelst;                     /* moves of the current stage */
+} movepicker_t;
+
+/* initializes a move picker for the given board, tt_move, killers (NR_KILLERS moves), counter_move and history may be NULL */
+void init_movepicker(movepicker_t* picker, board_t* board, move_t* tt_move, move_t* killers, move_t* counter_move, history_t* history);
+/* writes the next move to try into move, returns 0 if there are no moves left */
+int next_move(movepicker_t* picker, move_t* move);
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef __NNUE_H__
+#define __NNUE_H__
+
+#include "include/engine-core/types.h"
+
+#define NNUE_INPUTS (64 * 12 * 64)  // HalfKA features: own king square x piece (own/their) x square
+#define NNUE_HIDDEN 128             // size of the accumulator (per perspective)
+#define NNUE_QA 255                 // quantization of the accumulator (clipped relu range)
+#define NNUE_QB 64                  // quantization of the output weights
+#define NNUE_SCALE 400              // scales the network output to centipawns
+#define NNUE_STACK_SIZE 256         // number of plies accumulators are kept for (has to exceed the search depth)
+
+#define NNUE_MAGIC 0x45554E4E       // "NNUE" (little endian)
+#define NNUE_VERSION 1
+#define NNUE_NO_PLY 0xFFFF          // ply of accumulator entries which belong to no position
+
+/* ------------------------------------------------------------------------------------------------ */
+/* structs and functions for the NNUE evaluation                                                    */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* piece which changed by a move, from (to) is NO_SQUARE if the piece was put onto (removed from) the board */
+typedef struct _dirtypiece_t {
+    piece_t pc;
+    square_t from;
+    square_t to;
+} dirtypiece_t;
+
+/* first layer output of the network for a position, one entry per ply */
+typedef struct _accumulator_t {
+    int16_t values[2][NNUE_HIDDEN];     /* accumulator of each perspective (valid if computed) */
+    uint8_t computed[2];                /* whether values are up to date (per perspective) */
+    uint16_t ply;                       /* ply number of the position the entry belongs to */
+    int nr_dirty;                       /* number of pieces changed by the move leading to the position */
+    dirtypiece_t dirty[3];              /* pieces changed by the move leading to the position */
+} accumulator_t;
+
+/* network weights (quantized) */
+typedef struct _nnue_t {
+    int loaded;                         /* whether a network was loaded (else eval_board uses PeSTO) */
+    int16_t* feature_weights;           /* NNUE_INPUTS x NNUE_HIDDEN */
+    int16_t feature_bias[NNUE_HIDDEN];
+    int16_t output_weights[2 * NNUE_HIDDEN]; /* weights of the player at turn, followed by the ones of the opponent */
+    int32_t output_bias;
+} nnue_t;
+
+extern nnue_t nnue_net;
+
+/* loads the network weights from a file, returns 1 on success (the previous network is kept otherwise) */
+int load_nnue(const char* path);
+/* frees the network weights, eval_board falls back to PeSTO */
+void unload_nnue(void);
+
+/* allocates the accumulators of a board (all invalid) */
+accumulator_t* init_accumulators(void);
+/* invalidates all accumulators of a board (e.g. after setting up a new position) */
+void reset_accumulators(accumulator_t* accumulators);
+
+/* returns the network evaluation from the view of the player at turn */
+int nnue_evaluate(board_t* board);
+/* returns the network evaluation computed from scratch (without the accumulators) */
+int nnue_evaluate_full(board_t* board);
+
+/* starts the accumulator entry of the next ply (which is computed lazily from its parent's when evaluating) */
+static inline accumulator_t* push_accumulator(board_t* board) {
+    accumulator_t* acc = &board->accumulators[(board->ply_no + 1) % NNUE_STACK_SIZE];
+    acc->ply = board->ply_no + 1;
+    acc->computed[WHITE] = 0;
+    acc->computed[BLACK] = 0;
+    acc->nr_dirty = 0;
+    return acc;
+}
+
+/* records the pieces a move changes in the accumulator entry of the next ply (has to be called before
+   the move is executed) */
+static inline void push_accumulator_move(board_t* board, move_t move) {
+    accumulator_t* acc = push_accumulator(board);
+    piece_t pc = board->playingfield[move.from];
+    player_t us = board->player;
+
+    switch (move.flags) {
+        case KCASTLE:
+        case QCASTLE: {
+            square_t rook_from = (move.flags == KCASTLE) ? move.from + 3 : move.from - 4;
+            square_t rook_to = (move.flags == KCASTLE) ? move.from + 1 : move.from - 1;
+            acc->dirty[0] = (dirtypiece_t){pc, move.from, move.to};
+            acc->dirty[1] = (dirtypiece_t){board->playingfield[rook_from], rook_from, rook_to};
+            acc->nr_dirty = 2;
+            return;
+        }
+        case EPCAPTURE: {
+            square_t captured_sq = (us == WHITE) ? move.to - 8 : move.to + 8;
+            acc->dirty[0] = (dirtypiece_t){pc, move.from, move.to};
+            acc->dirty[1] = (dirtypiece_t){board->playingfield[captured_sq], captured_sq, NO_SQUARE};
+            acc->nr_dirty = 2;
+            return;
+        }
+        default:
+            break;
+    }
+
+    if (move.flags & 0b1000) {
+        /* promotions remove the pawn and put the new piece */
+        piece_t promoted = (piece_t) (((us == WHITE) ? W_PAWN : B_PAWN) + KNIGHT + (move.flags & 0b11));
+        acc->dirty[0] = (dirtypiece_t){pc, move.from, NO_SQUARE};
+        acc->dirty[1] = (dirtypiece_t){promoted, NO_SQUARE, move.to};
+        acc->nr_dirty = 2;
+    } else {
+        acc->dirty[0] = (dirtypiece_t){pc, move.from, move.to};
+        acc->nr_dirty = 1;
+    }
+    if (move.flags & 0b0100) {
+        acc->dirty[acc->nr_dirty++] = (dirtypiece_t){board->playingfield[move.to], move.to, NO_SQUARE};
+    }
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __PAWNS_H__
+#define __PAWNS_H__
+
+#include "include/engine-core/types.h"
+
+#define PAWN_TABLE_SIZE (1 << 14)   // entries (power of two), 256KB per thread
+
+/* ------------------------------------------------------------------------------------------------ */
+/* structs and functions for the pawn structure evaluation                                          */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* cached pawn structure score of a pawn hash key (from white's view) */
+typedef struct _pawnentry_t {
+    uint64_t key;
+    int16_t mg;
+    int16_t eg;
+} pawnentry_t;
+
+/* pawn hash table (one per search thread, so no locking is needed) */
+typedef struct _pawntable_t {
+    pawnentry_t* entries;
+    uint64_t probes;                /* number of lookups */
+    uint64_t hits;                  /* number of lookups which found the pawn structure */
+} pawntable_t;
+
+/* allocates an (empty) pawn hash table */
+pawntable_t init_pawn_table(void);
+/* frees the memory of a pawn hash table */
+void free_pawn_table(pawntable_t* table);
+
+/* writes the midgame and endgame pawn structure scores (from white's view) into mg and eg, using the
+   table as cache (may be NULL) */
+void evaluate_pawns(board_t* board, pawntable_t* table, int* mg, int* eg);
+
+#endif
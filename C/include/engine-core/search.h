@@ -4,14 +4,33 @@
 #include <limits.h>
 
 #include "include/engine-core/types.h"
+#include "include/engine-core/eval.h"
+#include "include/engine-core/pawns.h"
 #include "include/engine-core/tt.h"
+#include "include/engine-core/movepicker.h"
 
-#define INF INT_MAX
+#define INF 32000        /* has to fit into the 16 bit score of a transposition table entry */
 #define NEGINF (-INF)
+#define MATE_BOUND (INF - MAXDEPTH)  /* scores beyond (-)MATE_BOUND are mates: INF - plies until the opponent is mated */
 
 #define MAXDEPTH 100    // plies
 #define STOP_ACCURACY 255 // nodes
 #define WINDOWSIZE 50   // centipawns
+#define MAXTHREADS 64   // search threads (lazy smp)
+
+#define FUTILITY_MARGIN 100     // centipawns per ply (futility pruning of quiet moves)
+#define FUTILITY_DEPTH 3        // plies (maximum depth for futility pruning)
+#define RAZOR_MARGIN 300        // centipawns per ply (razoring)
+#define RAZOR_DEPTH 2           // plies (maximum depth for razoring)
+#define LMP_BASE 8              // quiet moves searched at least (late move pruning, plus depth squared)
+#define LMP_DEPTH 3             // plies (maximum depth for late move pruning)
+#define IIR_DEPTH 4             // plies (minimum depth for internal iterative reduction)
+#define PROBCUT_MARGIN 200      // centipawns (above beta a capture has to hold for probcut)
+#define PROBCUT_DEPTH 5         // plies (minimum depth for probcut)
+#define PROBCUT_REDUCTION 4     // plies (the probcut search is reduced by)
+#define SINGULAR_DEPTH 8        // plies (minimum depth for singular extensions)
+#define SINGULAR_MARGIN 2       // centipawns per ply (the alternatives have to stay below the table score by)
+#define QSEARCH_CHECKS 0        // search quiet checks in the first ply of quiescence search (0 = off)
 
 typedef enum _ttflag_t {
     EXACT,
@@ -44,17 +63,52 @@ typedef struct _search_timer_t {
     int time_available;              /* tells the engine how much time it has to search in ms */
 } search_timer_t;
 
+/* principal variation (line of best moves) from some ply on */
+typedef struct _pv_line_t {
+    int length;                     /* number of moves in the line */
+    move_t moves[MAXDEPTH];
+} pv_line_t;
+
+/* per ply information about the current search path (indexed by ply, 0 being the root) */
+typedef struct _search_stack_t {
+    int in_check;                   /* whether the player to move is in check */
+    int32_t static_eval;            /* static evaluation of the position (TT_NO_EVAL if in check or not evaluated) */
+    move_t current_move;            /* move currently searched ({0,0,0,0} for null moves) */
+    move_t killers[NR_KILLERS];     /* quiet moves which caused a beta cutoff (in sibling nodes) */
+    int reduction;                  /* plies the search of this ply was reduced by (late move or null move reduction) */
+    int on_pv;                      /* whether the path to this ply follows the principal variation of the last iteration */
+    move_t excluded_move;           /* move skipped while verifying it is singular ({0,0,0,0} if none) */
+} search_stack_t;
+
 typedef struct _searchdata_t {
     board_t* board;                 /* pointer to the actual board */
-    tt_t tt;                        /* transposition table for the search */
+    tt_t tt;                        /* transposition table for the search (shared by all threads, */
+                                    /* owned by the caller and kept across searches) */
+
+    int thread_id;                  /* id of the search thread (0 = main thread) */
+    int nr_threads;                 /* number of threads searching in parallel (lazy smp) */
     
     search_timer_t timer;                  /* timer for time management */
 
     int ponder;                     /* tells engine to start search at ponder move */
+    int lazy_eval_margin;           /* margin (in centipawns) outside the window for lazy evaluation in quiescence */
+    int futility_margin;            /* futility pruning margin per ply in centipawns (0 = off) */
+    int razor_margin;               /* razoring margin per ply in centipawns (0 = off) */
+    int lmp_base;                   /* moves searched before late move pruning starts (0 = off) */
+    int probcut_margin;             /* margin above beta for probcut in centipawns (0 = off) */
+    int qsearch_checks;             /* search quiet checks in the first ply of quiescence search (0 = off) */
 
     int depth_with_ext;             /* tracks the "actual" depth of search i.e. with extensions */
     int max_seldepth;               /* maximum depth searched while in quiescence search */
     move_t* best_move;              /* best move in (iterative) search so far */    
+    move_t root_best_move;          /* best root move found by this thread in the last iteration */
+    pv_line_t root_pv;              /* principal variation found by this thread in the last iteration */
+    pv_line_t pv[MAXDEPTH + 1];     /* triangular pv table: principal variation of the current node at every ply */
+    history_t history;              /* how often quiet moves caused a beta cutoff (by player, from, to) */
+    move_t counter_moves[64][64];   /* quiet move refuting the previous move (by its from, to square) */
+    search_stack_t stack[MAXDEPTH + 1]; /* information about every ply of the current search path */
+    pawntable_t pawn_table;         /* cached pawn structure evaluations (per thread) */
+    evalcache_t eval_cache;         /* cached static evaluations (per thread) */
     int best_eval;                  /* corresponding evaluation of best move */
     uint64_t nodes_searched;             /* amount of nodes searched */
     int hash_used;                  /* amount of hash table hits that lead to not */
@@ -62,12 +116,41 @@ typedef struct _searchdata_t {
     int hash_bounds_adjusted;       /* amount of hash table hits that lead to */ 
                                     /* adjustment of alpha/beta bounds */
     int pv_node_hit;                /* amount of pv moves that turned out to be the best move */
+    uint64_t fail_high;             /* amount of beta cutoffs */
+    uint64_t fail_high_first;       /* amount of beta cutoffs caused by the first move searched */
+    uint64_t tt_static_evals;       /* amount of static evaluations taken from the transposition table */
+    uint64_t lazy_evals;            /* amount of quiescence nodes decided by the evaluation estimate alone */
+    uint64_t lmr_searches;          /* amount of searches reduced by late move reduction */
+    uint64_t lmr_researches;        /* amount of reduced searches which failed high and were searched again */
+    uint64_t singular_searches;     /* amount of searches verifying whether the table move is singular */
+    uint64_t singular_extensions;   /* amount of table moves extended since they turned out to be singular */
+    uint64_t probcut_cutoffs;       /* amount of nodes cut off by probcut */
 } searchdata_t;
 
+/* converts a mate score (relative to the root) into one relative to the node at the given ply, */
+/* as stored in the transposition table (other scores are kept) */
+static inline int32_t score_to_tt(int32_t score, int ply) {
+    if (score >= MATE_BOUND) return score + ply;
+    if (score <= -MATE_BOUND) return score - ply;
+    return score;
+}
+
+/* converts a mate score stored in the transposition table (relative to the node at the given ply) */
+/* back into one relative to the root (other scores are kept) */
+static inline int32_t score_from_tt(int32_t score, int ply) {
+    if (score >= MATE_BOUND) return score - ply;
+    if (score <= -MATE_BOUND) return score + ply;
+    return score;
+}
+
 /* returns an initialized searchdata struct with default values */
-searchdata_t* init_search_data(board_t* board, int tt_size_in_mb, int local_lag, int remote_lag);
-/* frees memory for searchdata struct */
+searchdata_t* init_search_data(board_t* board, tt_t tt, int nr_threads, int local_lag, int remote_lag);
+/* frees memory for searchdata struct (but not the transposition table) */
 void free_search_data(searchdata_t* data);
+/* returns a searchdata struct for a helper thread, sharing the transposition table of the main thread */
+searchdata_t* init_helper_data(searchdata_t* main_data, int thread_id);
+/* frees memory for a helper thread's searchdata struct (but not the shared transposition table) */
+void free_helper_data(searchdata_t* data);
 
 /* ------------------------------------------------------------------------------------------------ */
 /* functions for time management                                                                    */
@@ -81,6 +164,17 @@ int calculate_time(searchdata_t *data);
 /* because of either (1) a STOP request or (2) we have used up our time to search */
 void check_time(search_timer_t* timer);
 
+/* tells the search to stop */
+/* NOTICE: the flag is written and read by different threads (UCI thread, main and helper threads) */
+static inline void stop_search(search_timer_t* timer) {
+    __atomic_store_n(&timer->stop, 1, __ATOMIC_RELAXED);
+}
+
+/* returns 1 if the search has to be stopped */
+static inline int search_stopped(search_timer_t* timer) {
+    return __atomic_load_n(&timer->stop, __ATOMIC_RELAXED);
+}
+
 /* ------------------------------------------------------------------------------------------------ */
 /* functions concerning search                                                                      */
 /* ------------------------------------------------------------------------------------------------ */
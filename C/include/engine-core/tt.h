@@ -4,33 +4,68 @@
 
 #include "include/engine-core/types.h"
 
-#define MB_TO_BYTES(x) (x * 1024 * 1024)
-#define BYTES_TO_MB(x) (x / 1024 / 1024)
+#define MB_TO_BYTES(x) ((uint64_t) (x) * 1024 * 1024)
+#define BYTES_TO_MB(x) ((x) / 1024 / 1024)
+
+#define CACHE_LINE_SIZE 64      /* bytes */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)     /* bytes */
+#define TT_CLEAR_MIN_SIZE MB_TO_BYTES(64)   /* bytes cleared atleast by every thread when clearing the table */
+#define TT_CLUSTER_SIZE 4       /* slots per cluster */
+#define TT_GENERATIONS 64       /* generations distinguishable by the 6 bit generation field */
+#define TT_AGE_WEIGHT 8         /* plies of depth an entry is worth less per generation of age */
+#define TT_HASHFULL_SAMPLE 1000 /* clusters sampled to estimate how full the table is */
+
+#define TT_FILE_MAGIC 0x4865726279545431ULL  /* "HerbyTT1" */
+#define TT_FILE_VERSION 2                    /* has to be increased whenever the slot format changes */
+
+#define TT_NO_EVAL INT16_MIN    /* static evaluation of entries stored without one (e.g. in check) */
 
 /* ------------------------------------------------------------------------------------------------ */
 /* structs for transposition table                                                                  */
 /* ------------------------------------------------------------------------------------------------ */
 
-/* transposition table entry */
+/* transposition table entry (unpacked, as handed out to the search) */
 typedef struct _tt_entry_t {
     uint64_t key;
     move_t best_move;
     int8_t depth;
     int32_t eval;
     int8_t flags; 
+    int16_t static_eval;        /* static evaluation of the position (TT_NO_EVAL if none was stored) */
 } tt_entry_t;
 
-/* transposition table bucket */
-typedef struct tt_bucket_t {
-    tt_entry_t always_replace;
-    tt_entry_t replace_if_better;
-} tt_bucket_t;
+/* transposition table slot (packed, as stored in the table) */
+/* the data word holds move, eval, depth, flags and generation, the key word holds the zobrist key xor'ed */
+/* with the data word. if two threads write the same slot at the same time, the slot might end */
+/* up with the key of one entry and the data of the other, which the xor check detects on retrieval */
+typedef struct _tt_slot_t {
+    uint64_t key;
+    uint64_t data;
+} tt_slot_t;
+
+/* transposition table cluster (fills exactly one cache line, so a probe costs at most one miss) */
+typedef struct _tt_cluster_t {
+    tt_slot_t slots[TT_CLUSTER_SIZE];
+} __attribute__((aligned(CACHE_LINE_SIZE))) tt_cluster_t;
+
+/* header of a transposition table file (a table persisted via a memory-mapped file) */
+typedef struct _tt_file_header_t {
+    uint64_t magic;             /* identifies the file as a transposition table */
+    uint32_t version;           /* version of the slot format */
+    uint32_t cluster_size;      /* size of a cluster in bytes */
+    uint64_t zobrist_seed;      /* seed of the zobrist keys the entries were stored with */
+    uint64_t size;              /* number of clusters */
+    uint8_t generation;         /* generation of the last search */
+} __attribute__((aligned(CACHE_LINE_SIZE))) tt_file_header_t;
 
 /* transposition table */
 typedef struct tt_t {
-    tt_bucket_t* buckets;
+    tt_cluster_t* clusters;
     int size;
     int no_bits;
+    uint8_t generation;         /* incremented with every new search, used to evict entries of old searches first */
+    tt_file_header_t* header;   /* header of the backing file (NULL, if the table lives in memory only) */
+    int fd;                     /* file descriptor of the backing file */
 } tt_t;
 
 /* ------------------------------------------------------------------------------------------------ */
@@ -38,21 +73,34 @@ typedef struct tt_t {
 /* ------------------------------------------------------------------------------------------------ */
 
 /* allocates memory for and initializes a transposition table */
-tt_t init_tt(int size_in_bytes);
-/* frees memory for a transposition table */
+tt_t init_tt(uint64_t size_in_bytes);
+/* opens (or creates) a transposition table backed by a memory-mapped file, keeping the entries */
+/* stored in it if the file is compatible (falls back to a table in memory if the file can't be used) */
+tt_t init_tt_file(char* path, uint64_t size_in_bytes);
+/* frees memory for a transposition table (and writes a file-backed table back to its file) */
 void free_tt(tt_t table);
 /* resets the transposition table */
 void reset_tt(tt_t table);
+/* resizes the transposition table (if the number of clusters stays the same, all entries are kept) */
+void resize_tt(tt_t* table, uint64_t size_in_bytes);
+/* starts a new generation of entries (has to be called before every new search) */
+void age_tt(tt_t* table);
 
 
 /* ------------------------------------------------------------------------------------------------ */
 /* functions for storing and retrieving of transposition table entries                              */
 /* ------------------------------------------------------------------------------------------------ */
 
-/* stores an entry in transposition table */
-void store_tt_entry(tt_t table, board_t* board, move_t move, int8_t depth, int32_t eval, int8_t flags);
-/* retrieves an entry from transposition table */
-tt_entry_t* retrieve_tt_entry(tt_t table, board_t* board);
+/* stores an entry in transposition table (static_eval is TT_NO_EVAL if the position was not evaluated) */
+void store_tt_entry(tt_t table, board_t* board, move_t move, int8_t depth, int32_t eval, int8_t flags, int32_t static_eval);
+/* retrieves an entry from transposition table, returns 1 (and fills entry) if found */
+int retrieve_tt_entry(tt_t table, board_t* board, tt_entry_t* entry);
+/* stores an entry under the given key (e.g. a variant of the position's zobrist key) */
+void store_tt_entry_by_key(tt_t table, uint64_t key, move_t move, int8_t depth, int32_t eval, int8_t flags, int32_t static_eval);
+/* retrieves the entry stored under the given key, returns 1 (and fills entry) if found */
+int retrieve_tt_entry_by_key(tt_t table, uint64_t key, tt_entry_t* entry);
+/* prefetches the cluster of the given zobrist key into the cache (a later retrieval then does not stall) */
+void prefetch_tt_entry(tt_t table, uint64_t key);
 /* Returns the eval for the board position from tt */
 int tt_eval(tt_t table, board_t* board);
 /* Gets the best move for the board position from tt */
@@ -64,7 +112,7 @@ move_t *tt_best_move(tt_t table, board_t *board);
 
 /* prints tt entry */
 void print_tt_entry(tt_entry_t* entry);
-/* returns how full the transposition table is in per mille */
+/* returns (an estimate of) how full the transposition table is with entries of the current search in per mille */
 int tt_permille_full(tt_t table);
 
 #endif
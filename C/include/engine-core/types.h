@@ -95,6 +95,13 @@ typedef struct _board_t {
     uint16_t ply_no;
 
     uint64_t hash;
+    uint64_t pawn_hash;     /* zobrist hash of the pawns only (for the pawn hash table) */
+
+    int mg[2];          /* midgame PeSTO score per player (updated incrementally) */
+    int eg[2];          /* endgame PeSTO score per player (updated incrementally) */
+    int phase;          /* game phase of the material on board (updated incrementally) */
+
+    struct _accumulator_t* accumulators;    /* NNUE accumulators per ply (computed lazily, see nnue.h) */
 } board_t;
 
 /* structure representing a move */
@@ -23,11 +23,27 @@ typedef struct _spin_value_t {
     int cur;
 } spin_value_t;
 
+#define STRING_VALUE_SIZE 1024
+
+typedef struct _string_value_t {
+    char def[STRING_VALUE_SIZE];
+    char cur[STRING_VALUE_SIZE];
+} string_value_t;
+
 /* chess engine options */
 typedef struct _options_t {
     spin_value_t opt_hash; 
+    string_value_t opt_hash_file;
+    string_value_t opt_eval_file;
+    spin_value_t opt_threads;
     spin_value_t opt_local_lag;
     spin_value_t opt_remote_lag;
+    spin_value_t opt_lazy_eval_margin;
+    spin_value_t opt_futility_margin;
+    spin_value_t opt_razor_margin;
+    spin_value_t opt_lmp_base;
+    spin_value_t opt_probcut_margin;
+    spin_value_t opt_qsearch_checks;
 } options_t;
 
 options_t init_options(void);
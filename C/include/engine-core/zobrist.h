@@ -7,8 +7,12 @@
 /* structs and functions for zobrist hashing                                                        */
 /* ------------------------------------------------------------------------------------------------ */
 
+#define ZOBRIST_SEED 0x48657262794B6579ULL  /* seed of the random numbers (fixed, so that hashes */
+                                            /* stay the same across runs, e.g. for a persistent table) */
+
 /* zobrist struct which holds 64-bit random numbers */
 typedef struct _zobrist_t {
+    uint64_t seed;                              /* seed the random numbers were generated with */
     uint64_t piece_random64[14][64];            /* random number for every piece-field pair*/
     uint64_t flag_random64[26];                 /* random number for every board flag */
 } zobrist_t;
@@ -20,5 +24,9 @@ extern zobrist_t zobrist_table;
 void initialize_zobrist_table(void);
 /* calculates zobrist hash for a given board */
 uint64_t calculate_zobrist_hash(board_t *board);
+/* calculates the pawn hash (zobrist keys of the pawns only) for a given board */
+uint64_t calculate_pawn_hash(board_t *board);
+/* returns the key of a position searched without the given move (distinct from the keys of all positions) */
+uint64_t excluded_move_hash(uint64_t hash, move_t move);
 
 #endif
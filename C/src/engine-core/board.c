@@ -5,6 +5,8 @@
 #include "include/engine-core/types.h"
 #include "include/engine-core/helpers.h"
 #include "include/engine-core/zobrist.h"
+#include "include/engine-core/eval.h"
+#include "include/engine-core/nnue.h"
 
 /* ------------------------------------------------------------------------------------------------ */
 /* functions for managing the board structure                                                       */
@@ -35,8 +37,11 @@ void clear_board(board_t* board) {
 
     board->ply_no = 0;
 
-    /* calculate board hash */
+    /* calculate board hash and evaluation state */
     board->hash = calculate_zobrist_hash(board);
+    board->pawn_hash = calculate_pawn_hash(board);
+    calculate_eval_state(board);
+    reset_accumulators(board->accumulators);
 }
 /* makes a deep copy of a board */
 board_t* copy_board(board_t* board) {
@@ -66,6 +71,16 @@ board_t* copy_board(board_t* board) {
     copy->ply_no = board->ply_no;
 
     copy->hash = board->hash;
+    copy->pawn_hash = board->pawn_hash;
+
+    for (int c = 0; c < 2; c++) {
+        copy->mg[c] = board->mg[c];
+        copy->eg[c] = board->eg[c];
+    }
+    copy->phase = board->phase;
+
+    /* the accumulators of the copy are recomputed on demand */
+    copy->accumulators = init_accumulators();
 
     return copy;
 }
@@ -73,12 +88,16 @@ board_t* copy_board(board_t* board) {
 /* allocates memory and initiliazes board by call to 'clear_board' */
 board_t* init_board(void) {
     board_t* board = (board_t*)malloc(sizeof(board_t));
+    board->accumulators = init_accumulators();
     clear_board(board);
     return board;
 }
 
 /* frees the memory of a board */
-void free_board(board_t* board) { free(board); }
+void free_board(board_t* board) {
+    free(board->accumulators);
+    free(board);
+}
 
 /* loads a board position based given a fen-string */
 void load_by_FEN(board_t* board, char* FEN) {
@@ -273,5 +292,7 @@ void load_by_FEN(board_t* board, char* FEN) {
 
     board->hash = calculate_zobrist_hash(board);
     board->history[0].hash = board->hash;
+    board->pawn_hash = calculate_pawn_hash(board);
+    calculate_eval_state(board);
     return;
 }
@@ -1,4 +1,10 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "include/engine-core/eval.h"
+#include "include/engine-core/nnue.h"
+#include "include/engine-core/zobrist.h"
 
 #include "include/engine-core/types.h"
 #include "include/engine-core/move.h"
@@ -182,34 +188,118 @@ void initialize_eval_tables(void) {
     }
 }
 
-int eval_board(board_t* board) {
-    int mg[2];
-    int eg[2];
-    int gamePhase = 0;
-
-    mg[WHITE] = 0;
-    mg[BLACK] = 0;
-    eg[WHITE] = 0;
-    eg[BLACK] = 0;
+/* recomputes the incrementally updated PeSTO scores and game phase of a board from scratch */
+void calculate_eval_state(board_t* board) {
+    board->mg[WHITE] = 0;
+    board->mg[BLACK] = 0;
+    board->eg[WHITE] = 0;
+    board->eg[BLACK] = 0;
+    board->phase = 0;
 
     /* evaluate each piece */
     for (int sq = 0; sq < 64; ++sq) {
         piece_t pc = board->playingfield[sq];
         if (pc != NO_PIECE) {
-            mg[PIECE_COLOR(pc)] += mg_table[pc][sq];
-            eg[PIECE_COLOR(pc)] += eg_table[pc][sq];
-            gamePhase += gamephaseInc[pc];
+            board->mg[PIECE_COLOR(pc)] += mg_table[pc][sq];
+            board->eg[PIECE_COLOR(pc)] += eg_table[pc][sq];
+            board->phase += gamephaseInc[pc];
         }
     }
+}
 
-    /* tapered eval */
-    int mgScore = mg[board->player] - mg[SWITCHSIDES(board->player)];
-    int egScore = eg[board->player] - eg[SWITCHSIDES(board->player)];
-    int mgPhase = gamePhase;
+#ifdef DEBUG_EVAL
+/* aborts if the incrementally updated scores of a board differ from a full recompute */
+static void check_eval_state(board_t* board) {
+    board_t recomputed = *board;
+    calculate_eval_state(&recomputed);
+    if (recomputed.mg[WHITE] != board->mg[WHITE] || recomputed.mg[BLACK] != board->mg[BLACK] ||
+        recomputed.eg[WHITE] != board->eg[WHITE] || recomputed.eg[BLACK] != board->eg[BLACK] ||
+        recomputed.phase != board->phase) {
+        fprintf(stderr, "incremental eval mismatch: mg %d/%d (expected %d/%d), eg %d/%d (expected %d/%d), phase %d (expected %d)\n",
+                board->mg[WHITE], board->mg[BLACK], recomputed.mg[WHITE], recomputed.mg[BLACK],
+                board->eg[WHITE], board->eg[BLACK], recomputed.eg[WHITE], recomputed.eg[BLACK],
+                board->phase, recomputed.phase);
+        abort();
+    }
+    if (calculate_pawn_hash(board) != board->pawn_hash) {
+        fprintf(stderr, "incremental pawn hash mismatch: %llx (expected %llx)\n",
+                (unsigned long long) board->pawn_hash, (unsigned long long) calculate_pawn_hash(board));
+        abort();
+    }
+}
+#endif
+
+/* returns the tapered score of the given midgame and endgame scores */
+static inline int taper(board_t* board, int mgScore, int egScore) {
+    int mgPhase = board->phase;
     if (mgPhase > 24) mgPhase = 24; /* in case of early promotion */
     int egPhase = 24 - mgPhase;
 
-    int eval = (mgScore * mgPhase + egScore * egPhase) / 24;
-    return eval;
+    return (mgScore * mgPhase + egScore * egPhase) / 24;
 }
 
+/* returns the evaluation from the view of the player at turn, i.e. the network evaluation if a network
+   is loaded and the tapered PeSTO evaluation plus pawn structure terms otherwise */
+int eval_board(board_t* board, pawntable_t* pawn_table) {
+    if (nnue_net.loaded) return nnue_evaluate(board);
+
+#ifdef DEBUG_EVAL
+    check_eval_state(board);
+#endif
+
+    /* tapered eval */
+    int mgScore = board->mg[board->player] - board->mg[SWITCHSIDES(board->player)];
+    int egScore = board->eg[board->player] - board->eg[SWITCHSIDES(board->player)];
+
+    /* pawn structure (mostly cached, as pawns rarely move) */
+    int pawn_mg, pawn_eg;
+    evaluate_pawns(board, pawn_table, &pawn_mg, &pawn_eg);
+    mgScore += (board->player == WHITE) ? pawn_mg : -pawn_mg;
+    egScore += (board->player == WHITE) ? pawn_eg : -pawn_eg;
+
+    return taper(board, mgScore, egScore);
+}
+
+/* returns the (constant time) material and positional part of the PeSTO evaluation from the view of the
+   player at turn, i.e. eval_board without the more expensive terms */
+int estimate_eval_board(board_t* board) {
+    int mgScore = board->mg[board->player] - board->mg[SWITCHSIDES(board->player)];
+    int egScore = board->eg[board->player] - board->eg[SWITCHSIDES(board->player)];
+    return taper(board, mgScore, egScore);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* functions for caching evaluations                                                                */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* allocates an (empty) evaluation cache */
+evalcache_t init_eval_cache(void) {
+    evalcache_t cache;
+    cache.entries = (uint64_t*) malloc(EVAL_CACHE_SIZE * sizeof(uint64_t));
+    memset(cache.entries, 0, EVAL_CACHE_SIZE * sizeof(uint64_t));
+    cache.probes = 0;
+    cache.hits = 0;
+    return cache;
+}
+
+/* frees the memory of an evaluation cache */
+void free_eval_cache(evalcache_t* cache) {
+    free(cache->entries);
+    cache->entries = NULL;
+}
+
+/* returns 1 (and the evaluation) if the evaluation of the board is cached */
+/* NOTICE: the lower key bits select the entry, so only the upper 48 bits have to be compared */
+int probe_eval_cache(evalcache_t* cache, board_t* board, int* eval) {
+    uint64_t entry = cache->entries[board->hash & (EVAL_CACHE_SIZE - 1)];
+    cache->probes++;
+    if ((entry ^ board->hash) >> 16) return 0;
+    cache->hits++;
+    *eval = (int16_t) (uint16_t) entry;
+    return 1;
+}
+
+/* stores the evaluation of the board in the cache (replacing whatever was stored in its entry) */
+void store_eval_cache(evalcache_t* cache, board_t* board, int eval) {
+    cache->entries[board->hash & (EVAL_CACHE_SIZE - 1)] = (board->hash & ~0xFFFFULL) | (uint16_t) eval;
+}
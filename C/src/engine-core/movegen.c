@@ -4,8 +4,10 @@
 
 #include "include/engine-core/types.h"
 #include "include/engine-core/helpers.h"
-#include "include/engine-core/pq.h"
+#include "include/engine-core/movelist.h"
 #include "include/engine-core/zobrist.h"
+#include "include/engine-core/eval.h"
+#include "include/engine-core/nnue.h"
 
 const bitboard_t MASK_FILE[8] = {
     0x101010101010101, 0x202020202020202, 0x404040404040404, 0x808080808080808,
@@ -842,46 +844,81 @@ square_t make_piece(player_t player, int pc) {
 
 /* Generates and adds moves to move list given a from square
 and a bitboard of target squares */
-void make_moves_quiet(maxpq_t *movelst, square_t from, bitboard_t targets) {
-    while (targets) insert(movelst, generate_move(from, pop_1st_bit(&targets), QUIET, 0));
+void make_moves_quiet(movelist_t *movelst, square_t from, bitboard_t targets) {
+    while (targets) add_move(movelst, generate_move(from, pop_1st_bit(&targets), QUIET, 0));
 }
 
 /* Generates and adds moves to move list given a from square
 and a bitboard of target squares */
-void make_moves_doubleep(maxpq_t *movelst, square_t from, bitboard_t targets) {
-    while (targets) insert(movelst, generate_move(from, pop_1st_bit(&targets), DOUBLEP, 0));
+void make_moves_doubleep(movelist_t *movelst, square_t from, bitboard_t targets) {
+    while (targets) add_move(movelst, generate_move(from, pop_1st_bit(&targets), DOUBLEP, 0));
 }
 
 /* Generates and adds moves to move list given a from square
 and a bitboard of target squares */
-void make_moves_capture(maxpq_t *movelst, board_t *board, square_t from, bitboard_t targets) {
+void make_moves_capture(movelist_t *movelst, board_t *board, square_t from, bitboard_t targets) {
     int piece_from = (board->playingfield[from] & 0b111);
     while (targets) {
         int p = pop_1st_bit(&targets);
         int piece_to = (board->playingfield[p] & 0b111);
-        insert(movelst, generate_move(from, p, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
+        add_move(movelst, generate_move(from, p, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
     }
 }
 
 /* Generates and adds moves to move list given a from square
 and a bitboard of target squares */
-void make_moves_epcapture(maxpq_t *movelst, square_t from, bitboard_t targets) {
-    while (targets) insert(movelst, generate_move(from, pop_1st_bit(&targets), EPCAPTURE, 0));
+void make_moves_epcapture(movelist_t *movelst, square_t from, bitboard_t targets) {
+    while (targets) add_move(movelst, generate_move(from, pop_1st_bit(&targets), EPCAPTURE, 0));
 }
 
 /* Generates and adds moves to move list given a from square
 and a bitboard of target squares */
-void make_moves_promcaptures(maxpq_t *movelst, square_t from, bitboard_t targets) {
+void make_moves_promcaptures(movelist_t *movelst, square_t from, bitboard_t targets) {
     while (targets) {
         int idx = pop_1st_bit(&targets);
-        insert(movelst, generate_move(from, idx, KCPROM, 2500));
-        insert(movelst, generate_move(from, idx, BCPROM, 2600));
-        insert(movelst, generate_move(from, idx, RCPROM, 2700));
-        insert(movelst, generate_move(from, idx, QCPROM, 2800));
+        add_move(movelst, generate_move(from, idx, KCPROM, 2500));
+        add_move(movelst, generate_move(from, idx, BCPROM, 2600));
+        add_move(movelst, generate_move(from, idx, RCPROM, 2700));
+        add_move(movelst, generate_move(from, idx, QCPROM, 2800));
     }
 }
 
-void generate_legals(board_t *board, maxpq_t *movelst) {
+/* Types of moves generate_legals can be restricted to */
+typedef enum _gentype_t {
+    GEN_ALL,            /* all legal moves */
+    GEN_TACTICAL,       /* captures, ep captures and (quiet & capture) promotions */
+    GEN_QUIET,          /* everything else, i.e. GEN_ALL without GEN_TACTICAL */
+    GEN_EVASIONS,       /* all legal moves of a player in check */
+    GEN_QUIET_CHECKS    /* quiet moves giving check (castling excluded) */
+} gentype_t;
+
+/* Squares from which the pieces of the player at turn give check (indexed by piece type), and the pieces
+   of the player at turn which give a discovered check by leaving the line to the enemy king */
+typedef struct _checkinfo_t {
+    bitboard_t check_squares[6];
+    bitboard_t discoverers;
+    square_t their_king_sq;
+} checkinfo_t;
+
+/* Restricts the targets of a quiet move of the piece on the from square to the ones the move type asks for,
+   i.e. for GEN_QUIET_CHECKS to the squares where the piece gives check (directly or discovered) */
+static inline __attribute__((always_inline)) bitboard_t quiet_targets(board_t *board, gentype_t type, checkinfo_t *ci,
+                                                                      square_t from, bitboard_t targets) {
+    if (type != GEN_QUIET_CHECKS) return targets;
+
+    bitboard_t mask = ci->check_squares[board->playingfield[from] & 0b111];
+    if (ci->discoverers & SQUARE_BB[from]) mask |= ~LINE[ci->their_king_sq][from];
+    return targets & mask;
+}
+
+/* Generates the legal moves of the given type for player at turn.
+   NOTICE: always called with a constant type, so the compiler specializes this function per type
+   and the checks on the type vanish */
+static inline __attribute__((always_inline)) void generate_legals(board_t *board, movelist_t *movelst, gentype_t type) {
+    /* Which parts of the moves are generated */
+    const int gen_quiets = (type != GEN_TACTICAL);
+    const int gen_tacticals = (type != GEN_QUIET && type != GEN_QUIET_CHECKS);
+
     player_t us = board->player;
     player_t them = SWITCHSIDES(us);
 
@@ -933,10 +970,30 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
     bb1 = their_orth_sliders_bb;
     while (bb1) danger |= attack_rook(pop_1st_bit(&bb1), all ^ SQUARE_BB[our_king_sq]);
 
+    /* Checking squares and discovered check candidates, only needed to generate quiet checks */
+    checkinfo_t ci;
+    if (type == GEN_QUIET_CHECKS) {
+        ci.their_king_sq = their_king_sq;
+        ci.check_squares[PAWN] = attack_pawn_single(their_king_sq, them);
+        ci.check_squares[KNIGHT] = KNIGHT_ATTACK[their_king_sq];
+        ci.check_squares[BISHOP] = attack_bishop(their_king_sq, all);
+        ci.check_squares[ROOK] = attack_rook(their_king_sq, all);
+        ci.check_squares[QUEEN] = ci.check_squares[BISHOP] | ci.check_squares[ROOK];
+        ci.check_squares[KING] = 0ULL;
+
+        /* Our sliders which would attack their king if not for exactly one of our pieces in between */
+        ci.discoverers = 0ULL;
+        bb1 = (attack_rook(their_king_sq, them_bb) & our_orth_sliders_bb) | (attack_bishop(their_king_sq, them_bb) & our_diag_sliders_bb);
+        while (bb1) {
+            bb2 = SQUARES_BETWEEN_BB[their_king_sq][pop_1st_bit(&bb1)] & all;
+            if (bb2 && (bb2 & (bb2 - 1)) == 0 && (bb2 & us_bb)) ci.discoverers |= bb2;
+        }
+    }
+
     /* King can move to surrounding squares, except attacked sqaures and squares which are blocked by own pieces */
     bb1 = KING_ATTACK[our_king_sq] & ~(us_bb | danger);
-    make_moves_quiet(movelst, our_king_sq, bb1 & ~them_bb);
-    make_moves_capture(movelst, board, our_king_sq, bb1 & them_bb);
+    if (gen_quiets) make_moves_quiet(movelst, our_king_sq, quiet_targets(board, type, &ci, our_king_sq, bb1 & ~them_bb));
+    if (gen_tacticals) make_moves_capture(movelst, board, our_king_sq, bb1 & them_bb);
 
     /* Save danger/attack map in board field */
     board->attackmap = danger;
@@ -995,23 +1052,24 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
                 case PAWN:
                     /* If the checker is a pawn, we must check for ep moves that can capture it */
                     /* This evaluates to true if the checking piece is the one which just double pushed */
-                    if (board->checkers == shift(SQUARE_BB[board->history[board->ply_no].epsq], relative_dir(us, SOUTH))) {
+                    if (gen_tacticals && board->checkers == shift(SQUARE_BB[board->history[board->ply_no].epsq], relative_dir(us, SOUTH))) {
                         /* We compute the bitboard of pawns which can ep capture the checking pawn */
                         bb1 = attack_pawn_single(board->history[board->ply_no].epsq, them) & our_pawns_bb & not_pinned;
 
-                        while (bb1) insert(movelst, generate_move(pop_1st_bit(&bb1), board->history[board->ply_no].epsq, EPCAPTURE, 0));
+                        while (bb1) add_move(movelst, generate_move(pop_1st_bit(&bb1), board->history[board->ply_no].epsq, EPCAPTURE, 0));
                     }
                     /* INTENTIONAL FALL THROUGH */
                     __attribute__((fallthrough));       /* silence warning */
                 case KNIGHT:
                     /* If the checker is either a pawn or a knight the only legal moves are to capture
-                    the checker. Only non-pinned pieces can capture it */
+                    the checker. Only non-pinned pieces can capture it (so there are no quiet moves besides king moves) */
+                    if (!gen_tacticals) return;
                     bb1 = attackers_from(board, checker_square, all, us) & not_pinned;
                     int piece_to = (board->playingfield[checker_square] & 0b111);
                     while (bb1) {
                         int p = pop_1st_bit(&bb1);
                         int piece_from = (board->playingfield[p] & 0b111);
-                        insert(movelst, generate_move(p, checker_square, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
+                        add_move(movelst, generate_move(p, checker_square, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
                     }
                     return;
                 default:
@@ -1030,6 +1088,9 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
         default: {
             /* NOT IN CHECK */
 
+            /* Evasions are only generated for a player in check (see generate_evasions) */
+            if (type == GEN_EVASIONS) return;
+
             /* We can capture any enemy piece */
             capture_mask = them_bb;
 
@@ -1037,7 +1098,7 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
             quiet_mask = ~all;
 
             /* Special handling of possible ep captures */
-            if (board->history[board->ply_no].epsq != NO_SQUARE) {
+            if (gen_tacticals && board->history[board->ply_no].epsq != NO_SQUARE) {
                 /* Compute bitboard of pawns which could capture on ep square */
                 bb2 = attack_pawn_single(board->history[board->ply_no].epsq, them) & our_pawns_bb;
                 bb1 = bb2 & not_pinned;
@@ -1067,7 +1128,7 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
                                           all ^ SQUARE_BB[s] ^ shift(SQUARE_BB[board->history[board->ply_no].epsq], relative_dir(us, SOUTH)),
                                           MASK_RANK[rank_of(our_king_sq)]) &
                           their_orth_sliders_bb) == 0)) {
-                        insert(movelst, generate_move(s, board->history[board->ply_no].epsq, EPCAPTURE, 0));
+                        add_move(movelst, generate_move(s, board->history[board->ply_no].epsq, EPCAPTURE, 0));
                     }
 
                     /* WARNING: The same situation for diagonal attacks (see "8/8/1k6/8/2pP4/8/5BK1/8 b - d3 0 1") is not handled.
@@ -1081,7 +1142,7 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
                 i.e. and the e.p. square is in line with the king */
                 bb1 = bb2 & board->pinned & LINE[board->history[board->ply_no].epsq][our_king_sq];
                 if (bb1) {
-                    insert(movelst, generate_move(find_1st_bit(bb1), board->history[board->ply_no].epsq, EPCAPTURE, 0));
+                    add_move(movelst, generate_move(find_1st_bit(bb1), board->history[board->ply_no].epsq, EPCAPTURE, 0));
                 }
             }
 
@@ -1090,20 +1151,20 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
                     2. No piece is blocking in between the king and rook
                     3. The king is not in check, moving through check or lands in check
             */
-            if (!((all | danger) & oo_blockers_mask(us)) && (oo_allowed(us, board->history[board->ply_no].castlerights))) {
+            if ((type == GEN_ALL || type == GEN_QUIET) && !((all | danger) & oo_blockers_mask(us)) && (oo_allowed(us, board->history[board->ply_no].castlerights))) {
                 if (us == WHITE) {
-                    insert(movelst, generate_move(e1, g1, KCASTLE, 0));
+                    add_move(movelst, generate_move(e1, g1, KCASTLE, 0));
                 } else {
-                    insert(movelst, generate_move(e8, g8, KCASTLE, 0));
+                    add_move(movelst, generate_move(e8, g8, KCASTLE, 0));
                 }
             }
             /* NOTICE: since attacks on the b square are not relevant for casteling
                     we have to mask it out when calculating castleing moves */
-            if (!((all | (danger & ~ignore_ooo_danger_bfile(us))) & ooo_blockers_mask(us)) && (ooo_allowed(us, board->history[board->ply_no].castlerights))) {
+            if ((type == GEN_ALL || type == GEN_QUIET) && !((all | (danger & ~ignore_ooo_danger_bfile(us))) & ooo_blockers_mask(us)) && (ooo_allowed(us, board->history[board->ply_no].castlerights))) {
                 if (us == WHITE) {
-                    insert(movelst, generate_move(e1, c1, QCASTLE, 0));
+                    add_move(movelst, generate_move(e1, c1, QCASTLE, 0));
                 } else {
-                    insert(movelst, generate_move(e8, c8, QCASTLE, 0));
+                    add_move(movelst, generate_move(e8, c8, QCASTLE, 0));
                 }
             }
 
@@ -1125,8 +1186,8 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
                     case QUEEN:
                         bb2 = (attack_bishop(s, all) | attack_rook(s, all)) & LINE[our_king_sq][s];
                 }
-                make_moves_quiet(movelst, s, bb2 & quiet_mask);
-                make_moves_capture(movelst, board, s, bb2 & capture_mask);
+                if (gen_quiets) make_moves_quiet(movelst, s, quiet_targets(board, type, &ci, s, bb2 & quiet_mask));
+                if (gen_tacticals) make_moves_capture(movelst, board, s, bb2 & capture_mask);
             }
 
             /* Pinned PAWN */
@@ -1135,6 +1196,8 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
                 s = pop_1st_bit(&bb1);
 
                 if (rank_of(s) == relative_rank(us, RANK7)) {
+                    if (!gen_tacticals) continue;
+
                     /* Quiet promotions are impossible since the square in front of the pawn will
                     either be occupied by the king or the pinner, or doing so would leave our king
                     in check */
@@ -1143,7 +1206,7 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
                 } else {
                     /* Captures */
                     bb2 = attack_pawn_single(s, us) & capture_mask & LINE[our_king_sq][s];
-                    make_moves_capture(movelst, board, s, bb2);
+                    if (gen_tacticals) make_moves_capture(movelst, board, s, bb2);
 
                     /* Single pawn pushes */
                     bb2 = shift(SQUARE_BB[s], relative_dir(us, NORTH)) & ~all & LINE[our_king_sq][s];
@@ -1153,8 +1216,10 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
                     bb3 = shift(bb2 & MASK_RANK[relative_rank(us, RANK3)],
                                 relative_dir(us, NORTH)) &
                           ~all & LINE[our_king_sq][s];
-                    make_moves_quiet(movelst, s, bb2);
-                    make_moves_doubleep(movelst, s, bb3);
+                    if (gen_quiets) {
+                        make_moves_quiet(movelst, s, quiet_targets(board, type, &ci, s, bb2));
+                        make_moves_doubleep(movelst, s, quiet_targets(board, type, &ci, s, bb3));
+                    }
                 }
             }
 
@@ -1169,8 +1234,8 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
     while (bb1) {
         s = pop_1st_bit(&bb1);
         bb2 = KNIGHT_ATTACK[s];
-        make_moves_quiet(movelst, s, bb2 & quiet_mask);
-        make_moves_capture(movelst, board, s, bb2 & capture_mask);
+        if (gen_quiets) make_moves_quiet(movelst, s, quiet_targets(board, type, &ci, s, bb2 & quiet_mask));
+        if (gen_tacticals) make_moves_capture(movelst, board, s, bb2 & capture_mask);
     }
 
     /* Non-pinned BISHOPS and QUEENS */
@@ -1178,8 +1243,8 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
     while (bb1) {
         s = pop_1st_bit(&bb1);
         bb2 = attack_bishop(s, all);
-        make_moves_quiet(movelst, s, bb2 & quiet_mask);
-        make_moves_capture(movelst, board, s, bb2 & capture_mask);
+        if (gen_quiets) make_moves_quiet(movelst, s, quiet_targets(board, type, &ci, s, bb2 & quiet_mask));
+        if (gen_tacticals) make_moves_capture(movelst, board, s, bb2 & capture_mask);
     }
 
     /* Non-pinned ROOKS and QUEENS */
@@ -1187,371 +1252,40 @@ void generate_legals(board_t *board, maxpq_t *movelst) {
     while (bb1) {
         s = pop_1st_bit(&bb1);
         bb2 = attack_rook(s, all);
-        make_moves_quiet(movelst, s, bb2 & quiet_mask);
-        make_moves_capture(movelst, board, s, bb2 & capture_mask);
+        if (gen_quiets) make_moves_quiet(movelst, s, quiet_targets(board, type, &ci, s, bb2 & quiet_mask));
+        if (gen_tacticals) make_moves_capture(movelst, board, s, bb2 & capture_mask);
     }
 
     /* Determine pawns which are NOT about to promote */
     bb1 = our_pawns_bb & not_pinned & ~MASK_RANK[relative_rank(us, RANK7)];
 
-    /* Single pawn pushes */
-    bb2 = shift(bb1, relative_dir(us, NORTH)) & ~all;
-
-    /* Double pawn pushes */
-    /* only pawns on rank 3/6 are eligible */
-    bb3 = shift(bb2 & MASK_RANK[relative_rank(us, RANK3)], relative_dir(us, NORTH)) & quiet_mask;
-
-    /* We &(and) bb2 with the quiet mask only later, as a non-check-blocking single push does NOT mean that the
-        corresponding double push is not blocking check either. */
-    bb2 &= quiet_mask;
-
-    while (bb2) {
-        s = pop_1st_bit(&bb2);
-        insert(movelst, generate_move(s - relative_dir(us, NORTH), s, QUIET, 0));
-    }
-
-    while (bb3) {
-        s = pop_1st_bit(&bb3);
-        insert(movelst, generate_move(s - relative_dir(us, NORTH_NORTH), s, DOUBLEP, 0));
-    }
-
-    /* Pawn captures */
-    bb2 = shift(bb1, relative_dir(us, NORTH_WEST)) & capture_mask;
-    bb3 = shift(bb1, relative_dir(us, NORTH_EAST)) & capture_mask;
-    int piece_from = PAWN_ID;
-    while (bb2) {
-        s = pop_1st_bit(&bb2);
-        int piece_to = (board->playingfield[s] & 0b111);
-        insert(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
-    }
-
-    while (bb3) {
-        s = pop_1st_bit(&bb3);
-        int piece_to = (board->playingfield[s] & 0b111);
-        insert(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
-    }
+    if (gen_quiets) {
+        /* Single pawn pushes */
+        bb2 = shift(bb1, relative_dir(us, NORTH)) & ~all;
 
-    /* Determine pawns which are about to promote */
-    bb1 = our_pawns_bb & not_pinned & MASK_RANK[relative_rank(us, RANK7)];
-    if (bb1) {
-        /* Quiet promotions */
-        bb2 = shift(bb1, relative_dir(us, NORTH)) & quiet_mask;
-        while (bb2) {
-            s = pop_1st_bit(&bb2);
-            /* One move is added for each promotion piece */
-            insert(movelst, generate_move(s - relative_dir(us, NORTH), s, KPROM, 2100));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH), s, BPROM, 2200));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH), s, RPROM, 2300));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH), s, QPROM, 2400));
-        }
+        /* Double pawn pushes */
+        /* only pawns on rank 3/6 are eligible */
+        bb3 = shift(bb2 & MASK_RANK[relative_rank(us, RANK3)], relative_dir(us, NORTH)) & quiet_mask;
 
-        /* Capture promotions */
-        bb2 = shift(bb1, relative_dir(us, NORTH_WEST)) & capture_mask;
-        bb3 = shift(bb1, relative_dir(us, NORTH_EAST)) & capture_mask;
+        /* We &(and) bb2 with the quiet mask only later, as a non-check-blocking single push does NOT mean that the
+            corresponding double push is not blocking check either. */
+        bb2 &= quiet_mask;
 
         while (bb2) {
             s = pop_1st_bit(&bb2);
-            /* One move is added for each promotion piece */
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, KCPROM, 2500));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, BCPROM, 2600));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, RCPROM, 2700));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, QCPROM, 2800));
+            if (!quiet_targets(board, type, &ci, s - relative_dir(us, NORTH), SQUARE_BB[s])) continue;
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH), s, QUIET, 0));
         }
 
         while (bb3) {
             s = pop_1st_bit(&bb3);
-            /* One move is added for each promotion piece */
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, KCPROM, 2500));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, BCPROM, 2600));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, RCPROM, 2700));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, QCPROM, 2800));
+            if (!quiet_targets(board, type, &ci, s - relative_dir(us, NORTH_NORTH), SQUARE_BB[s])) continue;
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH_NORTH), s, DOUBLEP, 0));
         }
     }
-}
 
-void generate_tactical_moves(board_t *board, maxpq_t *movelst) {
-    player_t us = board->player;
-    player_t them = SWITCHSIDES(us);
-
-    bitboard_t us_bb = (us == WHITE) ? (board->piece_bb[W_PAWN] | board->piece_bb[W_KNIGHT] | board->piece_bb[W_BISHOP] |
-                                        board->piece_bb[W_ROOK] | board->piece_bb[W_QUEEN] | board->piece_bb[W_KING])
-                                     : (board->piece_bb[B_PAWN] | board->piece_bb[B_KNIGHT] | board->piece_bb[B_BISHOP] |
-                                        board->piece_bb[B_ROOK] | board->piece_bb[B_QUEEN] | board->piece_bb[B_KING]);
-    bitboard_t them_bb = (us == WHITE) ? (board->piece_bb[B_PAWN] | board->piece_bb[B_KNIGHT] | board->piece_bb[B_BISHOP] |
-                                          board->piece_bb[B_ROOK] | board->piece_bb[B_QUEEN] | board->piece_bb[B_KING])
-                                       : (board->piece_bb[W_PAWN] | board->piece_bb[W_KNIGHT] | board->piece_bb[W_BISHOP] |
-                                          board->piece_bb[W_ROOK] | board->piece_bb[W_QUEEN] | board->piece_bb[W_KING]);
-    bitboard_t all = us_bb | them_bb;
-
-    square_t our_king_sq = (us == WHITE) ? find_1st_bit(board->piece_bb[W_KING]) : find_1st_bit(board->piece_bb[B_KING]);
-    square_t their_king_sq = (us == WHITE) ? find_1st_bit(board->piece_bb[B_KING]) : find_1st_bit(board->piece_bb[W_KING]);
-
-    bitboard_t our_diag_sliders_bb = diagonal_sliders(board, us);
-    bitboard_t their_diag_sliders_bb = diagonal_sliders(board, them);
-    bitboard_t our_orth_sliders_bb = orthogonal_sliders(board, us);
-    bitboard_t their_orth_sliders_bb = orthogonal_sliders(board, them);
-
-    bitboard_t our_pawns_bb = (us == WHITE) ? board->piece_bb[W_PAWN] : board->piece_bb[B_PAWN];
-    bitboard_t our_knights_bb = (us == WHITE) ? board->piece_bb[W_KNIGHT] : board->piece_bb[B_KNIGHT];
-
-    bitboard_t their_pawns_bb = (them == WHITE) ? board->piece_bb[W_PAWN] : board->piece_bb[B_PAWN];
-    bitboard_t their_knights_bb = (them == WHITE) ? board->piece_bb[W_KNIGHT] : board->piece_bb[B_KNIGHT];
-
-    /* General purpose bitboards for attacks, masks, etc. */
-    bitboard_t bb1, bb2, bb3;
-
-    /* Squares the king can not move to */
-    bitboard_t danger = 0ULL;
-
-    /* For each enemy piece add it's attacks to the danger bitboards */
-    /* Attacks by PAWNS and KINGS */
-    danger |= attack_pawn_multiple(their_pawns_bb, them) | KING_ATTACK[their_king_sq];
-
-    /* Attacks by KNIGHTS */
-    bb1 = their_knights_bb;
-    while (bb1) danger |= KNIGHT_ATTACK[pop_1st_bit(&bb1)];
-
-    /* Diagonal attacks by BISHOPS and QUEENS */
-    /* NOTICE: we xor out the king square to secure that squares x-rayed are also included in attack mask */
-    bb1 = their_diag_sliders_bb;
-    while (bb1) danger |= attack_bishop(pop_1st_bit(&bb1), all ^ SQUARE_BB[our_king_sq]);
-
-    /* Orthogonal attacks by BISHOPS and QUEENS */
-    /* NOTICE: we xor out the king square to secure that squares x-rayed are also included in attack mask */
-    bb1 = their_orth_sliders_bb;
-    while (bb1) danger |= attack_rook(pop_1st_bit(&bb1), all ^ SQUARE_BB[our_king_sq]);
-
-    /* King can move to surrounding squares, except attacked sqaures and squares which are blocked by own pieces */
-    bb1 = KING_ATTACK[our_king_sq] & ~(us_bb | danger);
-    make_moves_capture(movelst, board, our_king_sq, bb1 & them_bb);
-
-    /* Save danger/attack map in board field */
-    board->attackmap = danger;
-
-    /* The capture mask filters destination squares to those that contain an enemy piece that is checking the
-        king and must be captured */
-    bitboard_t capture_mask;
-
-    /* The quiet mask filter destination squares to those where pieces must be moved to block an incoming attack
-    to the king */
-    bitboard_t quiet_mask;
-
-    /* A general purpose square for storing destinations, etc. */
-    square_t s;
-
-    /* Checking pieces are identified by:
-                1. Computing attacks from the king square
-                2. Intersecting this attack bitboard with the enemy bitboard of that piece type
-        */
-    board->checkers = (KNIGHT_ATTACK[our_king_sq] & their_knights_bb) | (attack_pawn_single(our_king_sq, us) & their_pawns_bb);
-
-    /* 	1. Compute sliding attacks from king square (excluding our pieces from the blockers mask,
-            to find potential pins in the next step).
-            2. Find bitboard of checking/pinning sliding pieces by intersecting with board in 1.
-    */
-    bitboard_t candidates = (attack_rook(our_king_sq, them_bb) & their_orth_sliders_bb) | (attack_bishop(our_king_sq, them_bb) & their_diag_sliders_bb);
-
-    /* The next bit of code determines checking and pinned pieces */
-    board->pinned = 0;
-    while (candidates) {
-        /* Intersect the line between (potentially) checking piece and
-         our king with the bitboard of our pieces */
-        s = pop_1st_bit(&candidates);
-        bb1 = SQUARES_BETWEEN_BB[our_king_sq][s] & us_bb;
-
-        /* If we find no pieces on this line, the attacking piece is a checking piece*/
-        if (bb1 == 0) board->checkers ^= SQUARE_BB[s];
-
-        /* Else if we find only one of our pieces on this line, it is a pinned piece */
-        else if ((bb1 & (bb1 - 1)) == 0)
-            board->pinned ^= bb1;
-    }
-
-    bitboard_t not_pinned = ~board->pinned;
-
-    switch (sparse_pop_count(board->checkers)) {
-        case 2:
-            /* DOUBLE CHECK */
-            /* If there is a double check the only legal moves are king moves */
-            return;
-        case 1: {
-            /* SINGLE CHECK */
-            square_t checker_square = find_1st_bit(board->checkers);
-
-            switch (board->playingfield[checker_square] & 0b111) {
-                case PAWN:
-                    /* If the checker is a pawn, we must check for ep moves that can capture it */
-                    /* This evaluates to true if the checking piece is the one which just double pushed */
-                    if (board->checkers == shift(SQUARE_BB[board->history[board->ply_no].epsq], relative_dir(us, SOUTH))) {
-                        /* We compute the bitboard of pawns which can ep capture the checking pawn */
-                        bb1 = attack_pawn_single(board->history[board->ply_no].epsq, them) & our_pawns_bb & not_pinned;
-
-                        while (bb1) insert(movelst, generate_move(pop_1st_bit(&bb1), board->history[board->ply_no].epsq, EPCAPTURE, 0));
-                    }
-                    /* INTENTIONAL FALL THROUGH */
-                    __attribute__((fallthrough));       /* silence warning */
-                case KNIGHT:
-                    /* If the checker is either a pawn or a knight the only legal moves are to capture
-                    the checker. Only non-pinned pieces can capture it */
-                    bb1 = attackers_from(board, checker_square, all, us) & not_pinned;
-                    int piece_to = (board->playingfield[checker_square] & 0b111);
-                    while (bb1) {
-                        int p = pop_1st_bit(&bb1);
-                        int piece_from = (board->playingfield[p] & 0b111);
-                        insert(movelst, generate_move(p, checker_square, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
-                    }
-                    return;
-                default:
-                    /* Else, we can either...*/
-                    /* (1) CAPTURE the checking piece */
-                    capture_mask = board->checkers;
-
-                    /* (2) BLOCK the attack since it is guaranteed to be from a slider */
-                    quiet_mask = SQUARES_BETWEEN_BB[our_king_sq][checker_square];
-                    break;
-            }
-
-            break;
-        }
-
-        default: {
-            /* NOT IN CHECK */
-
-            /* We can capture any enemy piece */
-            capture_mask = them_bb;
-
-            /* We can play a quiet move to any square which is not occupied */
-            quiet_mask = ~all;
-
-            /* Special handling of possible ep captures */
-            if (board->history[board->ply_no].epsq != NO_SQUARE) {
-                /* Compute bitboard of pawns which could capture on ep square */
-                bb2 = attack_pawn_single(board->history[board->ply_no].epsq, them) & our_pawns_bb;
-                bb1 = bb2 & not_pinned;
-                while (bb1) {
-                    s = pop_1st_bit(&bb1);
-
-                    /* This piece of evil bit-fiddling magic prevents the infamous 'pseudo-pinned' e.p. case,
-                    where the pawn is not directly pinned, but on moving the pawn and capturing the enemy pawn
-                    e.p., a rook or queen attack to the king is revealed */
-
-                    /*
-                    .nbqkbnr
-                    ppp.pppp
-                    ........
-                    r..pP..K
-                    ........
-                    ........
-                    PPPP.PPP
-                    RNBQ.BNR
-
-                    Here, if white plays exd5 e.p., the black rook on a5 attacks the white king on h5
-                    */
-
-                    /* We xor out (1) us and (2) the 'ep-pawn', then compute sliding attacks from the king square,
-                    mask this with the rank the king is standing on, and intersect this with orthogonal attackers of the enemy */
-                    if (((sliding_attacks(our_king_sq,
-                                          all ^ SQUARE_BB[s] ^ shift(SQUARE_BB[board->history[board->ply_no].epsq], relative_dir(us, SOUTH)),
-                                          MASK_RANK[rank_of(our_king_sq)]) &
-                          their_orth_sliders_bb) == 0)) {
-                        insert(movelst, generate_move(s, board->history[board->ply_no].epsq, EPCAPTURE, 0));
-                    }
-
-                    /* WARNING: The same situation for diagonal attacks (see "8/8/1k6/8/2pP4/8/5BK1/8 b - d3 0 1") is not handled.
-                    In a normal game of chess, positions like the one above can not occur legally.
-                    !!! Be warned that move generation on custom made positions might be wrong !!!
-                    Stockfish, for example, still handles positions like this though.
-                    */
-                }
-
-                /* Pinned pawns can only ep capture if they are pinned diagonally
-                i.e. and the e.p. square is in line with the king */
-                bb1 = bb2 & board->pinned & LINE[board->history[board->ply_no].epsq][our_king_sq];
-                if (bb1) {
-                    insert(movelst, generate_move(find_1st_bit(bb1), board->history[board->ply_no].epsq, EPCAPTURE, 0));
-                }
-            }
-
-            /* Compute moves for PINNED pieces */
-            /* Pinned BISHOPS, ROOK, QUEEN */
-            bb1 = ~(not_pinned | our_knights_bb | our_pawns_bb);
-            while (bb1) {
-                s = pop_1st_bit(&bb1);
-
-                /* Since, the pieces are pinned we only generate moves for which the moving piece
-                does not leave the line between king and checking piece */
-                switch (board->playingfield[s] & 0b111) {
-                    case BISHOP:
-                        bb2 = attack_bishop(s, all) & LINE[our_king_sq][s];
-                        break;
-                    case ROOK:
-                        bb2 = attack_rook(s, all) & LINE[our_king_sq][s];
-                        break;
-                    case QUEEN:
-                        bb2 = (attack_bishop(s, all) | attack_rook(s, all)) & LINE[our_king_sq][s];
-                }
-                make_moves_capture(movelst, board, s, bb2 & capture_mask);
-            }
-
-            /* Pinned PAWN */
-            bb1 = ~not_pinned & our_pawns_bb;
-            while (bb1) {
-                s = pop_1st_bit(&bb1);
-
-                if (rank_of(s) == relative_rank(us, RANK7)) {
-                    /* Quiet promotions are impossible since the square in front of the pawn will
-                    either be occupied by the king or the pinner, or doing so would leave our king
-                    in check */
-                    bb2 = attack_pawn_single(s, us) & capture_mask & LINE[our_king_sq][s];
-                    make_moves_promcaptures(movelst, s, bb2);
-                } else {
-                    /* Captures */
-                    bb2 = attack_pawn_single(s, us) & capture_mask & LINE[our_king_sq][s];
-                    make_moves_capture(movelst, board, s, bb2);
-
-                    /* Single pawn pushes */
-                    bb2 = shift(SQUARE_BB[s], relative_dir(us, NORTH)) & ~all & LINE[our_king_sq][s];
-
-                    /* Double pawn pushes */
-                    /* only pawns on rank 3/6 are eligible */
-                    bb3 = shift(bb2 & MASK_RANK[relative_rank(us, RANK3)],
-                                relative_dir(us, NORTH)) &
-                          ~all & LINE[our_king_sq][s];
-                }
-            }
-
-            /* Pinned KNIGHTS cannot move anywhere, so we're done with pinned pieces! */
-
-            break;
-        }
-    }
-
-    /* Non-pinned KNIGHT moves */
-    bb1 = our_knights_bb & not_pinned;
-    while (bb1) {
-        s = pop_1st_bit(&bb1);
-        bb2 = KNIGHT_ATTACK[s];
-        make_moves_capture(movelst, board, s, bb2 & capture_mask);
-    }
-
-    /* Non-pinned BISHOPS and QUEENS */
-    bb1 = our_diag_sliders_bb & not_pinned;
-    while (bb1) {
-        s = pop_1st_bit(&bb1);
-        bb2 = attack_bishop(s, all);
-        make_moves_capture(movelst, board, s, bb2 & capture_mask);
-    }
-
-    /* Non-pinned ROOKS and QUEENS */
-    bb1 = our_orth_sliders_bb & not_pinned;
-    while (bb1) {
-        s = pop_1st_bit(&bb1);
-        bb2 = attack_rook(s, all);
-        make_moves_capture(movelst, board, s, bb2 & capture_mask);
-    }
-
-    /* Determine pawns which are NOT about to promote */
-    bb1 = our_pawns_bb & not_pinned & ~MASK_RANK[relative_rank(us, RANK7)];
+    /* Everything below is tactical (captures and promotions) */
+    if (!gen_tacticals) return;
 
     /* Pawn captures */
     bb2 = shift(bb1, relative_dir(us, NORTH_WEST)) & capture_mask;
@@ -1560,13 +1294,13 @@ void generate_tactical_moves(board_t *board, maxpq_t *movelst) {
     while (bb2) {
         s = pop_1st_bit(&bb2);
         int piece_to = (board->playingfield[s] & 0b111);
-        insert(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
+        add_move(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
     }
 
     while (bb3) {
         s = pop_1st_bit(&bb3);
         int piece_to = (board->playingfield[s] & 0b111);
-        insert(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
+        add_move(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, CAPTURE, piece_to * 100 + (KING_ID - piece_from)));
     }
 
     /* Determine pawns which are about to promote */
@@ -1577,10 +1311,10 @@ void generate_tactical_moves(board_t *board, maxpq_t *movelst) {
         while (bb2) {
             s = pop_1st_bit(&bb2);
             /* One move is added for each promotion piece */
-            insert(movelst, generate_move(s - relative_dir(us, NORTH), s, KPROM, 2100));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH), s, BPROM, 2200));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH), s, RPROM, 2300));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH), s, QPROM, 2400));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH), s, KPROM, 2100));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH), s, BPROM, 2200));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH), s, RPROM, 2300));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH), s, QPROM, 2400));
         }
 
         /* Capture promotions */
@@ -1590,26 +1324,47 @@ void generate_tactical_moves(board_t *board, maxpq_t *movelst) {
         while (bb2) {
             s = pop_1st_bit(&bb2);
             /* One move is added for each promotion piece */
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, KCPROM, 2500));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, BCPROM, 2600));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, RCPROM, 2700));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, QCPROM, 2800));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, KCPROM, 2500));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, BCPROM, 2600));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, RCPROM, 2700));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH_WEST), s, QCPROM, 2800));
         }
 
         while (bb3) {
             s = pop_1st_bit(&bb3);
             /* One move is added for each promotion piece */
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, KCPROM, 2500));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, BCPROM, 2600));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, RCPROM, 2700));
-            insert(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, QCPROM, 2800));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, KCPROM, 2500));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, BCPROM, 2600));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, RCPROM, 2700));
+            add_move(movelst, generate_move(s - relative_dir(us, NORTH_EAST), s, QCPROM, 2800));
         }
     }
 }
 
 /* Generates all legal moves for player at turn */
-void generate_moves(board_t *board, maxpq_t *movelst) {
-    generate_legals(board, movelst);
+void generate_moves(board_t *board, movelist_t *movelst) {
+    generate_legals(board, movelst, GEN_ALL);
+}
+
+/* Generates all legal captures and promotions for player at turn */
+void generate_tactical_moves(board_t *board, movelist_t *movelst) {
+    generate_legals(board, movelst, GEN_TACTICAL);
+}
+
+/* Generates all legal quiet moves (no captures, no promotions) for player at turn */
+void generate_quiet_moves(board_t *board, movelist_t *movelst) {
+    generate_legals(board, movelst, GEN_QUIET);
+}
+
+/* Generates all legal moves for player at turn, who is in check */
+/* WARNING: Only call if the player at turn is in check (otherwise only king moves are generated) */
+void generate_evasions(board_t *board, movelist_t *movelst) {
+    generate_legals(board, movelst, GEN_EVASIONS);
+}
+
+/* Generates all legal quiet moves (no captures, no promotions, no castling) giving check for player at turn */
+void generate_quiet_checks(board_t *board, movelist_t *movelst) {
+    generate_legals(board, movelst, GEN_QUIET_CHECKS);
 }
 
 ///////////////////////////////////////////////////////////////
@@ -1617,6 +1372,10 @@ void generate_moves(board_t *board, maxpq_t *movelst) {
 
 void remove_piece(board_t *board, square_t sq) {
     board->hash ^= zobrist_table.piece_random64[board->playingfield[sq]][sq];
+    if ((board->playingfield[sq] & 0b111) == PAWN) board->pawn_hash ^= zobrist_table.piece_random64[board->playingfield[sq]][sq];
+    board->mg[PIECE_COLOR(board->playingfield[sq])] -= mg_table[board->playingfield[sq]][sq];
+    board->eg[PIECE_COLOR(board->playingfield[sq])] -= eg_table[board->playingfield[sq]][sq];
+    board->phase -= gamephaseInc[board->playingfield[sq]];
     board->piece_bb[board->playingfield[sq]] &= ~SQUARE_BB[sq];
     board->playingfield[sq] = NO_PIECE;
 }
@@ -1625,6 +1384,10 @@ void put_piece(board_t *board, piece_t pc, square_t sq) {
     board->piece_bb[pc] |= SQUARE_BB[sq];
     board->playingfield[sq] = pc;
     board->hash ^= zobrist_table.piece_random64[pc][sq];
+    if ((pc & 0b111) == PAWN) board->pawn_hash ^= zobrist_table.piece_random64[pc][sq];
+    board->mg[PIECE_COLOR(pc)] += mg_table[pc][sq];
+    board->eg[PIECE_COLOR(pc)] += eg_table[pc][sq];
+    board->phase += gamephaseInc[pc];
 }
 
 void move_piece(board_t *board, square_t from, square_t to) {
@@ -1632,6 +1395,14 @@ void move_piece(board_t *board, square_t from, square_t to) {
     board->hash ^= zobrist_table.piece_random64[board->playingfield[from]][from] ^
                    zobrist_table.piece_random64[board->playingfield[from]][to] ^
                    zobrist_table.piece_random64[board->playingfield[to]][to];
+    piece_t pc = board->playingfield[from], captured = board->playingfield[to];
+    if ((pc & 0b111) == PAWN) board->pawn_hash ^= zobrist_table.piece_random64[pc][from] ^ zobrist_table.piece_random64[pc][to];
+    if ((captured & 0b111) == PAWN) board->pawn_hash ^= zobrist_table.piece_random64[captured][to];
+    board->mg[PIECE_COLOR(pc)] += mg_table[pc][to] - mg_table[pc][from];
+    board->eg[PIECE_COLOR(pc)] += eg_table[pc][to] - eg_table[pc][from];
+    board->mg[PIECE_COLOR(captured)] -= mg_table[captured][to];
+    board->eg[PIECE_COLOR(captured)] -= eg_table[captured][to];
+    board->phase -= gamephaseInc[captured];
     bitboard_t mask = SQUARE_BB[from] | SQUARE_BB[to];
     board->piece_bb[board->playingfield[from]] ^= mask;
     board->piece_bb[board->playingfield[to]] &= ~mask;
@@ -1642,16 +1413,106 @@ void move_piece(board_t *board, square_t from, square_t to) {
 void move_piece_quiet(board_t *board, square_t from, square_t to) {
     board->hash ^= zobrist_table.piece_random64[board->playingfield[from]][from] ^
                    zobrist_table.piece_random64[board->playingfield[from]][to];
+    piece_t pc = board->playingfield[from];
+    if ((pc & 0b111) == PAWN) board->pawn_hash ^= zobrist_table.piece_random64[pc][from] ^ zobrist_table.piece_random64[pc][to];
+    board->mg[PIECE_COLOR(pc)] += mg_table[pc][to] - mg_table[pc][from];
+    board->eg[PIECE_COLOR(pc)] += eg_table[pc][to] - eg_table[pc][from];
     board->piece_bb[board->playingfield[from]] ^= (SQUARE_BB[from] | SQUARE_BB[to]);
     board->playingfield[to] = board->playingfield[from];
     board->playingfield[from] = NO_PIECE;
 }
 
+/* Returns the castle rights after a move */
+static inline flag_t castlerights_after_move(flag_t castlerights, move_t move) {
+    /* adjust castling rights if (potentially) king or rook moved from their start squares */
+    if (move.from == a1)
+        castlerights &= ~(LONGSIDEW);
+    else if (move.from == h1)
+        castlerights &= ~(SHORTSIDEW);
+    else if (move.from == a8)
+        castlerights &= ~(LONGSIDEB);
+    else if (move.from == h8)
+        castlerights &= ~(SHORTSIDEB);
+    else if (move.from == e1)
+        castlerights &= ~(SHORTSIDEW | LONGSIDEW);
+    else if (move.from == e8)
+        castlerights &= ~(SHORTSIDEB | LONGSIDEB);
+
+    /* adjust castle rights if rooks were (potentially) captured on their start squares */
+    if (move.to == h1)
+        castlerights &= ~(SHORTSIDEW);
+    else if (move.to == a1)
+        castlerights &= ~(LONGSIDEW);
+    else if (move.to == h8)
+        castlerights &= ~(SHORTSIDEB);
+    else if (move.to == a8)
+        castlerights &= ~(LONGSIDEB);
+
+    return castlerights;
+}
+
+/* Calculates the zobrist hash of the board after a move, without executing it */
+uint64_t hash_after_move(board_t *board, move_t move) {
+    uint64_t hash = board->hash;
+    piece_t piece = board->playingfield[move.from];
+    piece_t captured = board->playingfield[move.to];
+    flag_t castlerights = board->history[board->ply_no].castlerights;
+    square_t epsq = board->history[board->ply_no].epsq;
+
+    /* xor out the old ep square and swap the old castle rights for the new ones */
+    if (epsq != NO_SQUARE) hash ^= zobrist_table.flag_random64[epsq % 8];
+    hash ^= zobrist_table.flag_random64[castlerights + 8] ^
+            zobrist_table.flag_random64[castlerights_after_move(castlerights, move) + 8];
+
+    /* move the piece (captured pieces are handled below) */
+    hash ^= zobrist_table.piece_random64[piece][move.from];
+    switch (move.flags) {
+        case QUIET:
+        case CAPTURE:
+        case EPCAPTURE:
+            hash ^= zobrist_table.piece_random64[piece][move.to];
+            break;
+        case DOUBLEP:
+            hash ^= zobrist_table.piece_random64[piece][move.to];
+            /* the new ep square lies on the same file as the pawn */
+            hash ^= zobrist_table.flag_random64[move.from % 8];
+            break;
+        case KCASTLE:
+            hash ^= zobrist_table.piece_random64[piece][move.to];
+            hash ^= zobrist_table.piece_random64[board->playingfield[move.to + 1]][move.to + 1] ^
+                    zobrist_table.piece_random64[board->playingfield[move.to + 1]][move.to - 1];
+            break;
+        case QCASTLE:
+            hash ^= zobrist_table.piece_random64[piece][move.to];
+            hash ^= zobrist_table.piece_random64[board->playingfield[move.to - 2]][move.to - 2] ^
+                    zobrist_table.piece_random64[board->playingfield[move.to - 2]][move.to + 1];
+            break;
+        default:
+            /* promotions, the promoted piece has the same color as the pawn */
+            hash ^= zobrist_table.piece_random64[(piece & 0b1000) | ((move.flags & 0b0011) + KNIGHT)][move.to];
+            break;
+    }
+
+    /* remove the captured piece */
+    if (move.flags == EPCAPTURE) {
+        square_t cap_sq = (board->player == WHITE) ? move.to - 8 : move.to + 8;
+        hash ^= zobrist_table.piece_random64[board->playingfield[cap_sq]][cap_sq];
+    } else if (move.flags & 0b0100) {
+        hash ^= zobrist_table.piece_random64[captured][move.to];
+    }
+
+    /* switch the player */
+    return hash ^ zobrist_table.flag_random64[24] ^ zobrist_table.flag_random64[25];
+}
+
 /* Execute move */
 void do_move(board_t *board, move_t move) {
     /* save current board hash in array */
     board->history[board->ply_no].hash = board->hash;
 
+    /* record the changed pieces for the (lazy) update of the NNUE accumulator */
+    push_accumulator_move(board, move);
+
     /* increase board ply number */
     board->ply_no++;
     uint16_t ply = board->ply_no;
@@ -1685,29 +1546,8 @@ void do_move(board_t *board, move_t move) {
         board->history[ply].full_move_counter++;
     }
 
-    /* adjust castling rights if (potentially) king or rook moved from their start squares */
-    if (move.from == a1)
-        board->history[ply].castlerights &= ~(LONGSIDEW);
-    else if (move.from == h1)
-        board->history[ply].castlerights &= ~(SHORTSIDEW);
-    else if (move.from == a8)
-        board->history[ply].castlerights &= ~(LONGSIDEB);
-    else if (move.from == h8)
-        board->history[ply].castlerights &= ~(SHORTSIDEB);
-    else if (move.from == e1)
-        board->history[ply].castlerights &= ~(SHORTSIDEW | LONGSIDEW);
-    else if (move.from == e8)
-        board->history[ply].castlerights &= ~(SHORTSIDEB | LONGSIDEB);
-
-    /* adjust castle rights if rooks were (potentially) captured on their start squares */
-    if (move.to == h1)
-        board->history[ply].castlerights &= ~(SHORTSIDEW);
-    else if (move.to == a1)
-        board->history[ply].castlerights &= ~(LONGSIDEW);
-    else if (move.to == h8)
-        board->history[ply].castlerights &= ~(SHORTSIDEB);
-    else if (move.to == a8)
-        board->history[ply].castlerights &= ~(LONGSIDEB);
+    /* adjust castling rights if (potentially) king or rook moved from or were captured on their start squares */
+    board->history[ply].castlerights = castlerights_after_move(board->history[ply].castlerights, move);
 
     moveflags_t type = move.flags;
     switch (type) {
@@ -1942,6 +1782,9 @@ void do_null_move(board_t *board) {
     /* save current board hash in array */
     board->history[board->ply_no].hash = board->hash;
 
+    /* the NNUE accumulator of the next ply equals the current one */
+    push_accumulator(board);
+
     /* increase board ply number */
     board->ply_no++;
     uint16_t ply = board->ply_no;
@@ -2025,3 +1868,63 @@ int is_in_check(board_t *board) {
 
     return 0;
 }
+
+/* Checks if a quiet move (e.g. a killer move of a sibling node) is legal in the current position */
+/* WARNING: Only use in right situations, i.e. when the checkers, pinned pieces and attack map of
+   the board are up to date (after calling one of the move generators on the current position) */
+int is_legal_quiet_move(board_t *board, move_t move) {
+    /* castling is left to the move generator */
+    if (move.flags != QUIET && move.flags != DOUBLEP) return 0;
+
+    player_t us = board->player;
+    piece_t pc = board->playingfield[move.from];
+    if (pc == NO_PIECE || (pc >> 3) != us || board->playingfield[move.to] != NO_PIECE) return 0;
+
+    bitboard_t all = board->piece_bb[W_PAWN] | board->piece_bb[W_KNIGHT] | board->piece_bb[W_BISHOP] |
+                     board->piece_bb[W_ROOK] | board->piece_bb[W_QUEEN] | board->piece_bb[W_KING] |
+                     board->piece_bb[B_PAWN] | board->piece_bb[B_KNIGHT] | board->piece_bb[B_BISHOP] |
+                     board->piece_bb[B_ROOK] | board->piece_bb[B_QUEEN] | board->piece_bb[B_KING];
+
+    /* Squares the piece can (pseudo-legally) move to */
+    bitboard_t targets;
+    switch (pc & 0b111) {
+        case PAWN:
+            /* pushes to the last rank are promotions (which are not quiet) */
+            if (rank_of(move.from) == relative_rank(us, RANK7)) return 0;
+            targets = shift(SQUARE_BB[move.from], relative_dir(us, NORTH)) & ~all;
+            if (move.flags == DOUBLEP) {
+                targets = shift(targets & MASK_RANK[relative_rank(us, RANK3)], relative_dir(us, NORTH)) & ~all;
+            }
+            break;
+        case KNIGHT:
+            targets = KNIGHT_ATTACK[move.from];
+            break;
+        case BISHOP:
+            targets = attack_bishop(move.from, all);
+            break;
+        case ROOK:
+            targets = attack_rook(move.from, all);
+            break;
+        case QUEEN:
+            targets = attack_bishop(move.from, all) | attack_rook(move.from, all);
+            break;
+        default:
+            /* the king may only step onto squares which are not attacked */
+            return move.flags == QUIET && (KING_ATTACK[move.from] & ~board->attackmap & SQUARE_BB[move.to]) != 0;
+    }
+    if (move.flags == DOUBLEP && (pc & 0b111) != PAWN) return 0;
+    if (!(targets & SQUARE_BB[move.to])) return 0;
+
+    square_t our_king_sq = (us == WHITE) ? find_1st_bit(board->piece_bb[W_KING]) : find_1st_bit(board->piece_bb[B_KING]);
+
+    /* when in check, a quiet move has to block the (single) checking slider */
+    if (board->checkers) {
+        if (board->checkers & (board->checkers - 1)) return 0;
+        if (!(SQUARES_BETWEEN_BB[our_king_sq][find_1st_bit(board->checkers)] & SQUARE_BB[move.to])) return 0;
+    }
+
+    /* pinned pieces can only move along the line between king and pinner */
+    if ((board->pinned & SQUARE_BB[move.from]) && !(LINE[our_king_sq][move.from] & SQUARE_BB[move.to])) return 0;
+
+    return 1;
+}
@@ -0,0 +1,16 @@
+#include <stdio.h>
+
+#include "include/engine-core/movelist.h"
+
+#include "include/engine-core/types.h"
+#include "include/engine-core/prettyprint.h"
+
+/* Prints move list (!in memory order, not logical order!) */
+void print_movelist(movelist_t* lst) {
+    for (int i = 0; i < lst->nr_elem; i++) {
+        print_move(lst->array[i]);
+        fprintf(stderr, " (%d)", lst->array[i].value);
+        fprintf(stderr, "   ");
+    }
+    fprintf(stderr, "\n");
+}
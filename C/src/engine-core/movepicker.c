@@ -0,0 +1,121 @@
+#include "include/engine-core/movepicker.h"
+
+#include "include/engine-core/types.h"
+#include "include/engine-core/move.h"
+#include "include/engine-core/movelist.h"
+
+/* checks if the move of a transposition table entry can be played on the board */
+/* NOTICE: the entry matched the full 64 bit key, so the move was legal in this very position (up to
+   a hash collision). Therefore a cheap sanity check, which protects do_move against garbage, is enough */
+static int is_sane_tt_move(board_t *board, move_t move) {
+    piece_t pc = board->playingfield[move.from];
+    piece_t captured = board->playingfield[move.to];
+
+    if (move.from == move.to || pc == NO_PIECE || (pc >> 3) != board->player) return 0;
+
+    /* normal captures (and capture promotions) need an enemy piece on the target square,
+       all other moves (including ep captures) an empty one */
+    if ((move.flags & 0b0100) && move.flags != EPCAPTURE) {
+        return captured != NO_PIECE && (captured >> 3) != board->player;
+    }
+    return captured == NO_PIECE;
+}
+
+/* initializes a move picker for the given board, tt_move, killers (NR_KILLERS moves), counter_move and history may be NULL */
+void init_movepicker(movepicker_t *picker, board_t *board, move_t *tt_move, move_t *killers, move_t *counter_move, history_t *history) {
+    picker->board = board;
+    picker->stage = STAGE_TT_MOVE;
+
+    picker->has_tt_move = (tt_move != NULL && is_sane_tt_move(board, *tt_move));
+    if (picker->has_tt_move) picker->tt_move = *tt_move;
+
+    for (int i = 0; i < NR_KILLERS; i++) {
+        picker->killers[i] = (killers != NULL) ? killers[i] : (move_t){0, 0, 0, 0};
+    }
+    picker->killer_idx = 0;
+    picker->killers_tried = 0;
+    picker->counter_move = (counter_move != NULL) ? *counter_move : (move_t){0, 0, 0, 0};
+    picker->history = history;
+
+    init_movelist(&picker->movelst);
+}
+
+/* checks if a move was already handed out in an earlier stage */
+static int already_tried(movepicker_t *picker, move_t move) {
+    if (picker->has_tt_move && is_same_move(move, picker->tt_move)) return 1;
+    for (int i = 0; i < NR_KILLERS; i++) {
+        if ((picker->killers_tried & (1 << i)) && is_same_move(move, picker->killers[i])) return 1;
+    }
+    return 0;
+}
+
+/* scores the generated quiet moves by their history (shifted to be non-negative), the counter move
+   gets a bonus on top (it is not tried as a separate stage, since it refutes the previous move at
+   other nodes of the tree, which makes it less reliable than the killer moves) */
+static void score_quiets(movepicker_t *picker) {
+    int16_t (*history)[64] = (*picker->history)[picker->board->player];
+    for (int i = 0; i < picker->movelst.nr_elem; i++) {
+        move_t *move = &picker->movelst.array[i];
+        move->value = history[move->from][move->to] + HISTORY_MAX;
+        if (is_same_move(*move, picker->counter_move)) move->value += COUNTER_MOVE_BONUS;
+    }
+}
+
+/* writes the next move to try into move, returns 0 if there are no moves left */
+int next_move(movepicker_t *picker, move_t *move) {
+    switch (picker->stage) {
+        case STAGE_TT_MOVE:
+            picker->stage = STAGE_GEN_TACTICAL;
+            if (picker->has_tt_move) {
+                *move = picker->tt_move;
+                return 1;
+            }
+            __attribute__((fallthrough));
+        case STAGE_GEN_TACTICAL:
+            generate_tactical_moves(picker->board, &picker->movelst);
+            picker->checkers = picker->board->checkers;
+            picker->pinned = picker->board->pinned;
+            picker->attackmap = picker->board->attackmap;
+            picker->stage = STAGE_TACTICAL;
+            __attribute__((fallthrough));
+        case STAGE_TACTICAL:
+            while (has_next(&picker->movelst)) {
+                *move = pick_next(&picker->movelst);
+                if (!already_tried(picker, *move)) return 1;
+            }
+            picker->stage = STAGE_KILLERS;
+            __attribute__((fallthrough));
+        case STAGE_KILLERS:
+            /* killers stem from sibling nodes, so they have to be checked for legality (which is
+               cheap, since generating the tactical moves has computed the pins and checkers, but the
+               search of the tactical moves has overwritten them on the board in the meantime) */
+            picker->board->checkers = picker->checkers;
+            picker->board->pinned = picker->pinned;
+            picker->board->attackmap = picker->attackmap;
+            while (picker->killer_idx < NR_KILLERS) {
+                int i = picker->killer_idx++;
+                *move = picker->killers[i];
+                if (already_tried(picker, *move) || !is_legal_quiet_move(picker->board, *move)) continue;
+                picker->killers_tried |= (1 << i);
+                return 1;
+            }
+            picker->stage = STAGE_GEN_QUIET;
+            __attribute__((fallthrough));
+        case STAGE_GEN_QUIET:
+            init_movelist(&picker->movelst);
+            generate_quiet_moves(picker->board, &picker->movelst);
+            if (picker->history) score_quiets(picker);
+            picker->stage = STAGE_QUIET;
+            __attribute__((fallthrough));
+        case STAGE_QUIET:
+            while (has_next(&picker->movelst)) {
+                *move = pick_next(&picker->movelst);
+                if (!already_tried(picker, *move)) return 1;
+            }
+            picker->stage = STAGE_DONE;
+            __attribute__((fallthrough));
+        case STAGE_DONE:
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "include/engine-core/nnue.h"
+
+#include "include/engine-core/types.h"
+#include "include/engine-core/helpers.h"
+#include "include/engine-core/search.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+nnue_t nnue_net = {.loaded = 0, .feature_weights = NULL};
+
+/* ------------------------------------------------------------------------------------------------ */
+/* SIMD kernels (AVX2, SSE4.1 or portable scalar code, chosen by the ARCH_FLAGS of the build)       */
+/* ------------------------------------------------------------------------------------------------ */
+
+#if defined(__AVX2__)
+typedef __m256i vec_t;
+#define VEC_SIZE 16     // int16 per vector
+#define vec_load(p) _mm256_loadu_si256((const __m256i *) (p))
+#define vec_store(p, v) _mm256_storeu_si256((__m256i *) (p), (v))
+#define vec_add_16(a, b) _mm256_add_epi16((a), (b))
+#define vec_sub_16(a, b) _mm256_sub_epi16((a), (b))
+#define vec_clamp_16(a) _mm256_min_epi16(_mm256_max_epi16((a), _mm256_setzero_si256()), _mm256_set1_epi16(NNUE_QA))
+#define vec_madd_16(a, b) _mm256_madd_epi16((a), (b))
+#define vec_add_32(a, b) _mm256_add_epi32((a), (b))
+#define vec_zero() _mm256_setzero_si256()
+
+/* sums the int32 lanes of a vector */
+static inline int32_t vec_hsum_32(vec_t v) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b01001110));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b10110001));
+    return _mm_cvtsi128_si32(sum);
+}
+#elif defined(__SSE4_1__)
+typedef __m128i vec_t;
+#define VEC_SIZE 8      // int16 per vector
+#define vec_load(p) _mm_loadu_si128((const __m128i *) (p))
+#define vec_store(p, v) _mm_storeu_si128((__m128i *) (p), (v))
+#define vec_add_16(a, b) _mm_add_epi16((a), (b))
+#define vec_sub_16(a, b) _mm_sub_epi16((a), (b))
+#define vec_clamp_16(a) _mm_min_epi16(_mm_max_epi16((a), _mm_setzero_si128()), _mm_set1_epi16(NNUE_QA))
+#define vec_madd_16(a, b) _mm_madd_epi16((a), (b))
+#define vec_add_32(a, b) _mm_add_epi32((a), (b))
+#define vec_zero() _mm_setzero_si128()
+
+/* sums the int32 lanes of a vector */
+static inline int32_t vec_hsum_32(vec_t v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0b01001110));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0b10110001));
+    return _mm_cvtsi128_si32(v);
+}
+#endif
+
+/* returns the weights of a feature in the first layer */
+static inline const int16_t *feature_weights(int feature) {
+    return &nnue_net.feature_weights[(size_t) feature * NNUE_HIDDEN];
+}
+
+/* returns the HalfKA feature of a piece on a square, seen from the given perspective with its king on ksq */
+/* NOTICE: black's view is mirrored vertically, so both perspectives see their own pieces moving up the board */
+static inline int feature_index(player_t perspective, square_t ksq, piece_t pc, square_t sq) {
+    if (perspective == BLACK) {
+        ksq ^= 56;
+        sq ^= 56;
+    }
+    int relative_piece = ((pc >> 3) == perspective ? 0 : 6) + (pc & 0b111);
+    return (ksq * 12 + relative_piece) * 64 + sq;
+}
+
+/* computes dst = src + (sum of weights of the added features) - (sum of weights of the removed features) */
+static void update_values(int16_t *dst, const int16_t *src, const int *added, int nr_added, const int *removed, int nr_removed) {
+#ifdef VEC_SIZE
+    for (int i = 0; i < NNUE_HIDDEN; i += VEC_SIZE) {
+        vec_t v = vec_load(&src[i]);
+        for (int j = 0; j < nr_added; j++) v = vec_add_16(v, vec_load(&feature_weights(added[j])[i]));
+        for (int j = 0; j < nr_removed; j++) v = vec_sub_16(v, vec_load(&feature_weights(removed[j])[i]));
+        vec_store(&dst[i], v);
+    }
+#else
+    /* one pass per feature, which lets the compiler vectorize the inner loops */
+    if (dst != src) memcpy(dst, src, NNUE_HIDDEN * sizeof(int16_t));
+    for (int j = 0; j < nr_added; j++) {
+        const int16_t *weights = feature_weights(added[j]);
+        for (int i = 0; i < NNUE_HIDDEN; i++) dst[i] += weights[i];
+    }
+    for (int j = 0; j < nr_removed; j++) {
+        const int16_t *weights = feature_weights(removed[j]);
+        for (int i = 0; i < NNUE_HIDDEN; i++) dst[i] -= weights[i];
+    }
+#endif
+}
+
+/* returns the sum of the clipped accumulator values multiplied by the output weights */
+static int32_t output_sum(const int16_t *values, const int16_t *weights) {
+#ifdef VEC_SIZE
+    vec_t sum = vec_zero();
+    for (int i = 0; i < NNUE_HIDDEN; i += VEC_SIZE) {
+        sum = vec_add_32(sum, vec_madd_16(vec_clamp_16(vec_load(&values[i])), vec_load(&weights[i])));
+    }
+    return vec_hsum_32(sum);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+        int32_t v = values[i] < 0 ? 0 : (values[i] > NNUE_QA ? NNUE_QA : values[i]);
+        sum += v * weights[i];
+    }
+    return sum;
+#endif
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* functions for managing the accumulators                                                          */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* allocates the accumulators of a board (all invalid) */
+accumulator_t *init_accumulators(void) {
+    accumulator_t *accumulators = (accumulator_t *) malloc(NNUE_STACK_SIZE * sizeof(accumulator_t));
+    reset_accumulators(accumulators);
+    return accumulators;
+}
+
+/* invalidates all accumulators of a board (e.g. after setting up a new position) */
+void reset_accumulators(accumulator_t *accumulators) {
+    for (int i = 0; i < NNUE_STACK_SIZE; i++) {
+        accumulators[i].ply = NNUE_NO_PLY;
+        accumulators[i].computed[WHITE] = 0;
+        accumulators[i].computed[BLACK] = 0;
+        accumulators[i].nr_dirty = 0;
+    }
+}
+
+/* computes the accumulator of a perspective from scratch */
+static void refresh_accumulator(board_t *board, int16_t *values, player_t perspective) {
+    square_t ksq = find_1st_bit(board->piece_bb[perspective == WHITE ? W_KING : B_KING]);
+    int features[32];
+    int nr_features = 0;
+
+    memcpy(values, nnue_net.feature_bias, sizeof(nnue_net.feature_bias));
+    for (int sq = 0; sq < 64; sq++) {
+        piece_t pc = board->playingfield[sq];
+        if (pc == NO_PIECE) continue;
+        features[nr_features++] = feature_index(perspective, ksq, pc, sq);
+        if (nr_features == 32) {
+            update_values(values, values, features, nr_features, NULL, 0);
+            nr_features = 0;
+        }
+    }
+    update_values(values, values, features, nr_features, NULL, 0);
+}
+
+/* returns whether the king of the perspective was moved in the entry (which changes all its features) */
+static inline int king_moved(accumulator_t *acc, player_t perspective) {
+    piece_t king = (perspective == WHITE) ? W_KING : B_KING;
+    for (int i = 0; i < acc->nr_dirty; i++) {
+        if (acc->dirty[i].pc == king) return 1;
+    }
+    return 0;
+}
+
+/* brings the accumulator of the current ply up to date for a perspective */
+/* NOTICE: the values are computed incrementally from the last computed entry of an ancestor, unless the king
+   of the perspective moved in between (or there is no such entry), then they are computed from scratch */
+static void update_accumulator(board_t *board, player_t perspective) {
+    int ply = board->ply_no;
+    accumulator_t *acc = &board->accumulators[ply % NNUE_STACK_SIZE];
+
+    /* the entry was never written for this position (or overwritten by a deeper ply since) */
+    if (acc->ply != ply) {
+        acc->ply = ply;
+        acc->nr_dirty = 0;
+        refresh_accumulator(board, acc->values[WHITE], WHITE);
+        refresh_accumulator(board, acc->values[BLACK], BLACK);
+        acc->computed[WHITE] = 1;
+        acc->computed[BLACK] = 1;
+    }
+    if (acc->computed[perspective]) return;
+
+    int from = ply;
+    while (1) {
+        accumulator_t *entry = &board->accumulators[from % NNUE_STACK_SIZE];
+        if (entry->ply != from || king_moved(entry, perspective) || from == 0 || ply - from >= NNUE_STACK_SIZE - 1) {
+            refresh_accumulator(board, acc->values[perspective], perspective);
+            acc->computed[perspective] = 1;
+            return;
+        }
+        from--;
+        if (board->accumulators[from % NNUE_STACK_SIZE].ply == from &&
+            board->accumulators[from % NNUE_STACK_SIZE].computed[perspective]) break;
+    }
+
+    /* the king did not move since, so its current square is the one of all entries in between */
+    square_t ksq = find_1st_bit(board->piece_bb[perspective == WHITE ? W_KING : B_KING]);
+    for (int p = from + 1; p <= ply; p++) {
+        accumulator_t *parent = &board->accumulators[(p - 1) % NNUE_STACK_SIZE];
+        accumulator_t *entry = &board->accumulators[p % NNUE_STACK_SIZE];
+        int added[3], removed[3];
+        int nr_added = 0, nr_removed = 0;
+        for (int i = 0; i < entry->nr_dirty; i++) {
+            dirtypiece_t d = entry->dirty[i];
+            if (d.from != NO_SQUARE) removed[nr_removed++] = feature_index(perspective, ksq, d.pc, d.from);
+            if (d.to != NO_SQUARE) added[nr_added++] = feature_index(perspective, ksq, d.pc, d.to);
+        }
+        update_values(entry->values[perspective], parent->values[perspective], added, nr_added, removed, nr_removed);
+        entry->computed[perspective] = 1;
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* functions for the network evaluation                                                             */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* returns the network output for the accumulators of the player at turn and its opponent */
+/* NOTICE: the output is clamped below the mate scores, so that it is neither mistaken for a mate
+   nor truncated by the 16 bit evaluations in the caches and the transposition table */
+static int network_output(const int16_t *us, const int16_t *them) {
+    int64_t sum = (int64_t) output_sum(us, nnue_net.output_weights) + output_sum(them, &nnue_net.output_weights[NNUE_HIDDEN]);
+    int64_t eval = (sum + nnue_net.output_bias) * NNUE_SCALE / (NNUE_QA * NNUE_QB);
+    if (eval >= MATE_BOUND) return MATE_BOUND - 1;
+    if (eval <= -MATE_BOUND) return -(MATE_BOUND - 1);
+    return (int) eval;
+}
+
+/* returns the network evaluation from the view of the player at turn */
+int nnue_evaluate(board_t *board) {
+    update_accumulator(board, WHITE);
+    update_accumulator(board, BLACK);
+
+    accumulator_t *acc = &board->accumulators[board->ply_no % NNUE_STACK_SIZE];
+    int eval = network_output(acc->values[board->player], acc->values[SWITCHSIDES(board->player)]);
+
+#ifdef DEBUG_EVAL
+    if (eval != nnue_evaluate_full(board)) {
+        fprintf(stderr, "incremental NNUE eval mismatch: %d (expected %d)\n", eval, nnue_evaluate_full(board));
+        abort();
+    }
+#endif
+    return eval;
+}
+
+/* returns the network evaluation computed from scratch (without the accumulators) */
+int nnue_evaluate_full(board_t *board) {
+    int16_t values[2][NNUE_HIDDEN];
+    refresh_accumulator(board, values[WHITE], WHITE);
+    refresh_accumulator(board, values[BLACK], BLACK);
+    return network_output(values[board->player], values[SWITCHSIDES(board->player)]);
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* functions for loading the network                                                                */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* loads the network weights from a file, returns 1 on success (the previous network is kept otherwise) */
+/* NOTICE: the file holds a header (magic, version, number of inputs and hidden neurons as uint32), followed
+   by the feature weights (input major), feature biases, output weights (int16) and output bias (int32), all
+   little endian. Accumulators computed before are not invalidated, so the network has to be loaded before
+   setting up the boards to search */
+int load_nnue(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "ERROR: could not open network file '%s'\n", path);
+        return 0;
+    }
+
+    uint32_t header[4];
+    int16_t *feature_weights = (int16_t *) malloc((size_t) NNUE_INPUTS * NNUE_HIDDEN * sizeof(int16_t));
+    nnue_t net = {.loaded = 1, .feature_weights = feature_weights};
+
+    int ok = fread(header, sizeof(uint32_t), 4, file) == 4 &&
+             header[0] == NNUE_MAGIC && header[1] == NNUE_VERSION && header[2] == NNUE_INPUTS && header[3] == NNUE_HIDDEN &&
+             fread(net.feature_weights, sizeof(int16_t), (size_t) NNUE_INPUTS * NNUE_HIDDEN, file) == (size_t) NNUE_INPUTS * NNUE_HIDDEN &&
+             fread(net.feature_bias, sizeof(int16_t), NNUE_HIDDEN, file) == NNUE_HIDDEN &&
+             fread(net.output_weights, sizeof(int16_t), 2 * NNUE_HIDDEN, file) == 2 * NNUE_HIDDEN &&
+             fread(&net.output_bias, sizeof(int32_t), 1, file) == 1;
+    fclose(file);
+
+    if (!ok) {
+        fprintf(stderr, "ERROR: '%s' is not a valid network file (expected %d inputs and %d hidden neurons)\n", path, NNUE_INPUTS, NNUE_HIDDEN);
+        free(feature_weights);
+        return 0;
+    }
+
+    unload_nnue();
+    nnue_net = net;
+    return 1;
+}
+
+/* frees the network weights, eval_board falls back to PeSTO */
+void unload_nnue(void) {
+    free(nnue_net.feature_weights);
+    nnue_net.feature_weights = NULL;
+    nnue_net.loaded = 0;
+}
@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/engine-core/pawns.h"
+
+#include "include/engine-core/types.h"
+#include "include/engine-core/helpers.h"
+
+#define FILE_A_BB 0x0101010101010101ULL
+#define FILE_H_BB 0x8080808080808080ULL
+
+/* penalties (midgame, endgame) for weak pawns */
+#define DOUBLED_MG -10
+#define DOUBLED_EG -25
+#define ISOLATED_MG -5
+#define ISOLATED_EG -15
+#define BACKWARD_MG -8
+#define BACKWARD_EG -12
+
+/* bonus for passed pawns by (relative) rank */
+const int PASSED_MG[8] = {0, 0, 5, 10, 20, 35, 60, 0};
+const int PASSED_EG[8] = {0, 10, 15, 25, 45, 75, 120, 0};
+
+/* ------------------------------------------------------------------------------------------------ */
+/* functions for managing the pawn hash table                                                       */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* allocates an (empty) pawn hash table */
+pawntable_t init_pawn_table(void) {
+    pawntable_t table;
+    table.entries = (pawnentry_t*) malloc(PAWN_TABLE_SIZE * sizeof(pawnentry_t));
+    memset(table.entries, 0, PAWN_TABLE_SIZE * sizeof(pawnentry_t));
+    table.probes = 0;
+    table.hits = 0;
+    return table;
+}
+
+/* frees the memory of a pawn hash table */
+void free_pawn_table(pawntable_t* table) {
+    free(table->entries);
+    table->entries = NULL;
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+/* functions for evaluating the pawn structure                                                      */
+/* ------------------------------------------------------------------------------------------------ */
+
+/* returns the squares attacked by the pawns of a player */
+static bitboard_t pawn_attacks(bitboard_t pawns, player_t player) {
+    if (player == WHITE) return ((pawns << 9) & ~FILE_A_BB) | ((pawns << 7) & ~FILE_H_BB);
+    return ((pawns >> 7) & ~FILE_A_BB) | ((pawns >> 9) & ~FILE_H_BB);
+}
+
+/* returns the ranks in front of the given rank (from the view of the player) */
+static bitboard_t ranks_in_front(rank_t rank, player_t player) {
+    if (player == WHITE) return (rank == RANK8) ? 0ULL : (~0ULL << (8 * (rank + 1)));
+    return (1ULL << (8 * rank)) - 1;
+}
+
+/* adds the scores of the doubled, isolated, backward and passed pawns of a player to mg and eg */
+static void score_pawns(board_t* board, player_t us, int* mg, int* eg) {
+    bitboard_t our_pawns = board->piece_bb[(us == WHITE) ? W_PAWN : B_PAWN];
+    bitboard_t their_pawns = board->piece_bb[(us == WHITE) ? B_PAWN : W_PAWN];
+    bitboard_t their_attacks = pawn_attacks(their_pawns, SWITCHSIDES(us));
+
+    bitboard_t pawns = our_pawns;
+    while (pawns) {
+        square_t sq = pop_1st_bit(&pawns);
+        bitboard_t file = FILE_A_BB << file_of(sq);
+        bitboard_t adjacent_files = ((file << 1) & ~FILE_A_BB) | ((file >> 1) & ~FILE_H_BB);
+        bitboard_t front = ranks_in_front(rank_of(sq), us);
+        int relative_rank = (us == WHITE) ? rank_of(sq) : 7 - rank_of(sq);
+        square_t stop_sq = (us == WHITE) ? sq + 8 : sq - 8;
+
+        /* a pawn with another pawn of ours in front of it (only the rear one is penalized) */
+        int doubled = (our_pawns & file & front) != 0;
+        if (doubled) {
+            *mg += DOUBLED_MG;
+            *eg += DOUBLED_EG;
+        }
+
+        /* a pawn without pawns of ours on adjacent files can never be defended by a pawn */
+        if (!(our_pawns & adjacent_files)) {
+            *mg += ISOLATED_MG;
+            *eg += ISOLATED_EG;
+        }
+        /* a pawn behind all pawns of ours on adjacent files, which cannot advance safely */
+        else if (!(our_pawns & adjacent_files & ~front) && (their_attacks & (1ULL << stop_sq))) {
+            *mg += BACKWARD_MG;
+            *eg += BACKWARD_EG;
+        }
+
+        /* a pawn which no pawn of theirs can stop (or capture) on its way to promotion */
+        if (!doubled && !(their_pawns & (file | adjacent_files) & front)) {
+            *mg += PASSED_MG[relative_rank];
+            *eg += PASSED_EG[relative_rank];
+        }
+    }
+}
+
+/* writes the midgame and endgame pawn structure scores (from white's view) into mg and eg, using the
+   table as cache (may be NULL) */
+void evaluate_pawns(board_t* board, pawntable_t* table, int* mg, int* eg) {
+    pawnentry_t* entry = NULL;
+    if (table) {
+        entry = &table->entries[board->pawn_hash & (PAWN_TABLE_SIZE - 1)];
+        table->probes++;
+        if (entry->key == board->pawn_hash) {
+            table->hits++;
+            *mg = entry->mg;
+            *eg = entry->eg;
+            return;
+        }
+    }
+
+    int white_mg = 0, white_eg = 0, black_mg = 0, black_eg = 0;
+    score_pawns(board, WHITE, &white_mg, &white_eg);
+    score_pawns(board, BLACK, &black_mg, &black_eg);
+    *mg = white_mg - black_mg;
+    *eg = white_eg - black_eg;
+
+    if (entry) {
+        entry->key = board->pawn_hash;
+        entry->mg = (int16_t) *mg;
+        entry->eg = (int16_t) *eg;
+    }
+}
@@ -12,16 +12,17 @@ uint64_t perft(board_t* board, int depth) {
         return 1;
     }
 
-    maxpq_t movelst;
-    initialize_maxpq(&movelst);
+    movelist_t movelst;
+    init_movelist(&movelst);
     generate_moves(board, &movelst);
 
     move_t move;
 
     uint64_t num_positions = 0;
 
-    while (!is_empty(&movelst)) {
-        move = pop_max(&movelst);
+    /* the order of the moves does not matter, so we simply walk the list */
+    for (int i = 0; i < movelst.nr_elem; i++) {
+        move = movelst.array[i];
         do_move(board, move);
         num_positions += perft(board, depth - 1);
         undo_move(board, move);
@@ -31,14 +32,14 @@ uint64_t perft(board_t* board, int depth) {
 
 /* Runs perft divide test for a given board and depth */
 uint64_t perft_divide(board_t* board, int depth) {
-    maxpq_t movelst;
-    initialize_maxpq(&movelst);
+    movelist_t movelst;
+    init_movelist(&movelst);
     generate_moves(board, &movelst);
 
     move_t move;
     uint64_t all_nodes_count = 0;
-    while (!is_empty(&movelst)) {
-        move = pop_max(&movelst);
+    while (has_next(&movelst)) {
+        move = pick_next(&movelst);
         do_move(board, move);
         uint64_t num_positions = perft(board, depth - 1);
         undo_move(board, move);
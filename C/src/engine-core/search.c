@@ -1,5 +1,7 @@
 #include <stdio.h>
+#include <math.h>
 #include <sys/time.h>
+#include <pthread.h>
 
 #include "include/engine-core/search.h"
 
@@ -9,11 +11,30 @@
 #include "include/engine-core/zobrist.h"
 #include "include/engine-core/tt.h"
 #include "include/engine-core/eval.h"
+#include "include/engine-core/nnue.h"
 #include "include/engine-core/prettyprint.h"
 
 #define NULL_MOVE_REDUCTION 2
+#define HISTORY_BONUS(depth) ((depth) * (depth) * 16 > 2048 ? 2048 : (depth) * (depth) * 16)
+#define MAX_QUIETS_TRIED 64
+#define LMR_MAX_MOVES 64        // moves (later moves are reduced like the last one of the table)
+#define LMR_BASE 0.75           // plies (late move reduction: base + log(depth) * log(move number) / divisor)
+#define LMR_DIVISOR 2.25
 #define PIECE_VALUE(X) (X == B_PAWN || X == W_PAWN) ? PAWNVALUE : (X == B_KNIGHT || X == W_KNIGHT) ? KNIGHTVALUE : (X == B_BISHOP || X == W_BISHOP) ? BISHOPVALUE : (X == B_ROOK || X == W_ROOK) ? ROOKVALUE : (X == B_QUEEN || X == W_QUEEN) ? QUEENVALUE : 20000
 
+/* late move reductions (in plies) by depth and move number */
+int lmr_table[MAXDEPTH + 1][LMR_MAX_MOVES];
+
+/* precomputes the late move reductions */
+void initialize_search_tables(void) {
+    for (int depth = 0; depth <= MAXDEPTH; depth++) {
+        for (int move_nr = 0; move_nr < LMR_MAX_MOVES; move_nr++) {
+            lmr_table[depth][move_nr] = (depth == 0 || move_nr == 0) ? 0 :
+                                        (int) (LMR_BASE + log(depth) * log(move_nr) / LMR_DIVISOR);
+        }
+    }
+}
+
 /* checks if the game is in late game, i.e. only kings and pawns are left */
 int is_lategame(board_t *board) {
     for (int i = 0; i < 64; i++) {
@@ -32,14 +53,15 @@ int is_lategame(board_t *board) {
 }
 
 /* creates score string for info output (for GUI) */
-char *get_mate_or_cp_value(int score, int depth) {
+/* NOTICE: mate scores tell the exact number of plies to the mate, which are converted into moves */
+char *get_mate_or_cp_value(int score) {
     char *buffer = (char *)malloc(1024);
     for (int i = 0; i < 1024; i++) buffer[i] = '\0';
 
-    if (score >= INF - MAXDEPTH) {
-        snprintf(buffer, 1024, "mate %d", (depth / 2));
-    } else if (score <= NEGINF + MAXDEPTH) {
-        snprintf(buffer, 1024, "mate %d", -(depth / 2));
+    if (score >= MATE_BOUND) {
+        snprintf(buffer, 1024, "mate %d", (INF - score + 1) / 2);
+    } else if (score <= -MATE_BOUND) {
+        snprintf(buffer, 1024, "mate %d", -((score - NEGINF) / 2));
     } else {
         snprintf(buffer, 1024, "cp %d", score);
     }
@@ -47,11 +69,16 @@ char *get_mate_or_cp_value(int score, int depth) {
 }
 
 /* determines a draw by threefold repitiion */
+/* NOTICE: positions before the last irreversible move (capture, pawn move or null move) can't repeat, */
+/* and only every second position has the same player to move, so only those are compared */
 int draw_by_repition(board_t *board) {
     uint64_t current_board_hash = board->hash;
 
+    int window = board->history[board->ply_no].fifty_move_counter;
+    if (window > board->ply_no) window = board->ply_no;
+
     int counter = 0;
-    for (int i = 0; i < board->ply_no; i++) {
+    for (int i = board->ply_no - 2; i >= board->ply_no - window; i -= 2) {
         if (board->history[i].hash == current_board_hash) counter++;
         if (counter == 2) {
             return 1;
@@ -60,6 +87,43 @@ int draw_by_repition(board_t *board) {
     return 0;
 }
 
+/* applies a bonus (or malus if negative) to the history score of a quiet move, the gravity term */
+/* scales the change down the closer the score already is to HISTORY_MAX (which it never exceeds) */
+static void update_history(searchdata_t *searchdata, move_t move, int bonus) {
+    int16_t *entry = &searchdata->history[searchdata->board->player][move.from][move.to];
+    *entry += bonus - *entry * abs(bonus) / HISTORY_MAX;
+}
+
+/* updates the killer moves, history and counter moves after a quiet move caused a beta cutoff */
+static void update_quiet_stats(searchdata_t *searchdata, int depth, int ply, move_t move, move_t *quiets_tried, int nr_quiets_tried) {
+    /* remember the move as killer move of this ply */
+    move_t *killers = searchdata->stack[ply].killers;
+    if (!is_same_move(move, killers[0])) {
+        killers[1] = killers[0];
+        killers[0] = move;
+    }
+
+    /* reward the move, and punish the quiet moves searched before it (which did not cut off) */
+    int bonus = HISTORY_BONUS(depth);
+    update_history(searchdata, move, bonus);
+    for (int i = 0; i < nr_quiets_tried; i++) update_history(searchdata, quiets_tried[i], -bonus);
+
+    /* remember the move as refutation of the previous move */
+    if (ply > 0) {
+        move_t previous = searchdata->stack[ply - 1].current_move;
+        if (previous.from != previous.to) searchdata->counter_moves[previous.from][previous.to] = move;
+    }
+}
+
+/* returns the static evaluation of the board, taken from the evaluation cache if possible */
+int32_t cached_eval_board(searchdata_t* searchdata) {
+    int eval;
+    if (probe_eval_cache(&searchdata->eval_cache, searchdata->board, &eval)) return eval;
+    eval = eval_board(searchdata->board, &searchdata->pawn_table);
+    store_eval_cache(&searchdata->eval_cache, searchdata->board, eval);
+    return eval;
+}
+
 /* quiescence search */
 int32_t quiesce(searchdata_t* searchdata, int pvs_ply, int ply, int alpha, int beta){
     searchdata->nodes_searched++;
@@ -67,12 +131,12 @@ int32_t quiesce(searchdata_t* searchdata, int pvs_ply, int ply, int alpha, int b
 
     /* check if we have exceeded the maximum search depth */
     if (pvs_ply + ply >= MAXDEPTH) {
-        return eval_board(searchdata->board);
+        return cached_eval_board(searchdata);
     }
 
     /* check if we have exceeded the maximum nodes to search */
     if (searchdata->nodes_searched >= searchdata->timer.max_nodes) {
-        searchdata->timer.stop = 1;
+        stop_search(&searchdata->timer);
     }
 
     /* every so often, check if our time has expired */
@@ -83,7 +147,7 @@ int32_t quiesce(searchdata_t* searchdata, int pvs_ply, int ply, int alpha, int b
     /* if we have to stop, exit search by returning 0 in all branches.
        we will simply use the information of last search as our result
        and discard any information gained in this search. */
-    if (searchdata->timer.stop == 1) {
+    if (search_stopped(&searchdata->timer)) {
         return 0;
     }
 
@@ -101,9 +165,24 @@ int32_t quiesce(searchdata_t* searchdata, int pvs_ply, int ply, int alpha, int b
     /* (atleast in the first few plies) of quiescence search, since the   */
     /* position is not quiet enough. Only in greater depths we allow this */
     /* (but rather for reasons of preventing search explosions).          */
+    /* LAZY EVALUATION: Most of the time material and piece positions     */
+    /* alone decide whether the stand-pat score fails high or low. So if  */
+    /* the cheap estimate of the evaluation lies outside the window by    */
+    /* more than a margin, we skip the expensive terms of the evaluation  */
+    /* (the network evaluation can not be split up this way).             */
     /* ================================================================== */
-    int32_t best_score_so_far = eval_board(searchdata->board);
-    if(!(ply <= 2 && is_in_check(searchdata->board)) && best_score_so_far >= beta) {
+    /* the first quiescence node was checked for check by its parent already (see pvs) */
+    int in_check = (ply <= 2) && ((ply == 0) ? searchdata->stack[pvs_ply].in_check : is_in_check(searchdata->board));
+    int32_t best_score_so_far;
+    int32_t estimate = estimate_eval_board(searchdata->board);
+    if (!nnue_net.loaded && (estimate - searchdata->lazy_eval_margin >= beta ||
+                             estimate + searchdata->lazy_eval_margin <= alpha)) {
+        best_score_so_far = estimate;
+        searchdata->lazy_evals++;
+    } else {
+        best_score_so_far = cached_eval_board(searchdata);
+    }
+    if(!in_check && best_score_so_far >= beta) {
         return best_score_so_far;
     }
     if (best_score_so_far > alpha) {
@@ -115,21 +194,39 @@ int32_t quiesce(searchdata_t* searchdata, int pvs_ply, int ply, int alpha, int b
     /* TACTICAL-MOVE ITERATION: We only want to search tactical/non-quiet */
     /* moves, i.e. captures and promotions. If we are in check (in the    */
     /* first few plies of quiescence search) we want to search all moves  */
-    /* instead of only captures and promotions.                           */
+    /* (the evasions) instead of only captures and promotions, and if     */
+    /* there are none, we are mated.                                      */
+    /* QUIET CHECKS: Optionally, in the first ply of quiescence search we */
+    /* also search the quiet moves giving check, so that mates and forc-  */
+    /* ing sequences right behind the horizon are not missed. Checks to   */
+    /* squares attacked by the opponent are skipped, since most of them   */
+    /* just lose the checking piece. The replies to the checks are eva-   */
+    /* sions, which keeps the search from exploding.                      */
     /* ================================================================== */
-    maxpq_t movelst;
-    initialize_maxpq(&movelst);
+    movelist_t movelst;
+    init_movelist(&movelst);
     
-    if(ply <= 2 && is_in_check(searchdata->board)){
-        generate_moves(searchdata->board, &movelst);
+    if(in_check){
+        generate_evasions(searchdata->board, &movelst);
+        if (movelst.nr_elem == 0) {
+            return NEGINF + pvs_ply + ply;
+        }
     } else {
         generate_tactical_moves(searchdata->board, &movelst);
+        if (ply == 0 && searchdata->qsearch_checks) {
+            generate_quiet_checks(searchdata->board, &movelst);
+        }
     }
+    /* squares attacked by the opponent (the searched moves overwrite the ones on the board) */
+    bitboard_t attackmap = searchdata->board->attackmap;
 
 
     move_t move;
-    while (!is_empty(&movelst)) {
-        move = pop_max(&movelst);
+    while (has_next(&movelst)) {
+        move = pick_next(&movelst);
+
+        /* skip quiet checks to attacked squares */
+        if (!in_check && !(move.flags & 0b1100) && ((1ULL << move.to) & attackmap)) continue;
         
         /* ================================================================== */
         /* SEE: Static Exchange Evaluation examines the consequence of a ser- */
@@ -185,16 +282,17 @@ int32_t quiesce(searchdata_t* searchdata, int pvs_ply, int ply, int alpha, int b
 /* fail-soft prinicipal variation search */
 int32_t pvs(searchdata_t *searchdata, int depth, int ply, int allow_null_move, int alpha, int beta){
     searchdata->nodes_searched++;
+    searchdata->pv[ply].length = 0;
     searchdata->depth_with_ext = (searchdata->depth_with_ext < ply) ? ply : searchdata->depth_with_ext;
 
     /* check if we have exceeded the maximum search depth */
     if (ply >= MAXDEPTH) {
-        return eval_board(searchdata->board);
+        return cached_eval_board(searchdata);
     }
 
     /* check if we have exceeded the maximum nodes to search */
     if (searchdata->nodes_searched >= searchdata->timer.max_nodes) {
-        searchdata->timer.stop = 1;
+        stop_search(&searchdata->timer);
     }
 
     /* every so often, check if our time has expired */
@@ -205,22 +303,56 @@ int32_t pvs(searchdata_t *searchdata, int depth, int ply, int allow_null_move, i
     /* if we have to stop, exit search by returning 0 in all branches.
        We will simply use the information of last search as our result
        and discard any information gained in this search. */
-    if (searchdata->timer.stop == 1) {
+    if (search_stopped(&searchdata->timer)) {
         return 0;
     }
 
-    /* check for draw by repitition or fifty move rule */
-    if ((searchdata->board->history[searchdata->board->ply_no].fifty_move_counter >= 100 &&
-         !(is_in_check(searchdata->board))) ||
-        draw_by_repition(searchdata->board)) {
+    /* whether we are in check was determined by the parent right after making the move (see below), */
+    /* so it is only computed at the root */
+    search_stack_t *ss = &searchdata->stack[ply];
+    if (ply == 0) {
+        ss->in_check = is_in_check(searchdata->board);
+        ss->on_pv = 1;
+    }
+    ss->static_eval = TT_NO_EVAL;
+
+    /* while verifying a singular move (see below), the node is searched without that move, and the */
+    /* results are kept apart from the ones of the full search by a variant of the zobrist key */
+    int excluded = (ss->excluded_move.from != ss->excluded_move.to);
+    uint64_t tt_key = excluded ? excluded_move_hash(searchdata->board->hash, ss->excluded_move) : searchdata->board->hash;
+
+    /* whether this is a pv node is decided by the window we were called with */
+    /* (mate distance pruning and the bounds of the table may narrow it below) */
+    int pv_node = (beta - alpha > 1);
+
+    /* check for draw by repitition or fifty move rule (at the root we still need a move to play) */
+    if (ply > 0 &&
+        ((searchdata->board->history[searchdata->board->ply_no].fifty_move_counter >= 100 &&
+         !ss->in_check) ||
+        draw_by_repition(searchdata->board))) {
         return 0;
     }
 
+    /* ================================================================== */
+    /* MATE DISTANCE PRUNING: Mate scores count the plies from the root,  */
+    /* so even mating right at the next ply can't score better than       */
+    /* INF - (ply + 1), and being mated right here can't score worse than */
+    /* NEGINF + ply. If a shorter mate was found elsewhere in the tree    */
+    /* already, the window collapses and the node can't change the result */
+    /* ================================================================== */
+    if (ply > 0) {
+        if (alpha < NEGINF + ply) alpha = NEGINF + ply;
+        if (beta > INF - ply - 1) beta = INF - ply - 1;
+        if (alpha >= beta) {
+            return alpha;
+        }
+    }
+
     /* ================================================================== */
     /* CHECK EXTENSIONS: If the player is in check, we extend the search  */
     /* depth by one.                                                      */
     /* ================================================================== */
-    if (is_in_check(searchdata->board)) {
+    if (ss->in_check) {
         depth++;
     }
 
@@ -242,11 +374,16 @@ int32_t pvs(searchdata_t *searchdata, int depth, int ply, int allow_null_move, i
     /* information stored in the table to determine if we can prune the   */
     /* search tree.                                                       */
     /* ================================================================== */
-    tt_entry_t* entry = retrieve_tt_entry(searchdata->tt, searchdata->board);
+    tt_entry_t entry;
+    int tt_hit = retrieve_tt_entry_by_key(searchdata->tt, tt_key, &entry);
+    /* (mate scores are stored relative to the node, see score_to_tt) */
+    if (tt_hit) entry.eval = score_from_tt(entry.eval, ply);
 
-    if(entry && entry->depth >= depth) {
-        int32_t pv_value = entry->eval;
-        switch(entry->flags){
+    /* at the root we never cut off, since the entry might stem from another thread's search, */
+    /* and neither in pv nodes, so that the principal variation is not cut off at the entry */
+    if(tt_hit && entry.depth >= depth && ply > 0 && !pv_node) {
+        int32_t pv_value = entry.eval;
+        switch(entry.flags){
             /* ================================================================== */
             /* EXACT SCORE: If the score of the entry is exact, we can simply     */
             /* return the score.                                                  */
@@ -300,13 +437,36 @@ int32_t pvs(searchdata_t *searchdata, int depth, int ply, int allow_null_move, i
     /* If we are in check we shouldnt use this technique, since (in       */
     /* theory) not making a move in check would result in an illegal      */
     /* position.                                                          */
+    /* The static evaluation is stored in the transposition table along-  */
+    /* side the search results, so a table hit saves evaluating again.    */
     /* ================================================================== */
-    if (!is_in_check(searchdata->board)){
-        int32_t score = eval_board(searchdata->board);
+    if (!ss->in_check){
+        if (tt_hit && entry.static_eval != TT_NO_EVAL) {
+            ss->static_eval = entry.static_eval;
+            searchdata->tt_static_evals++;
+        } else {
+            ss->static_eval = cached_eval_board(searchdata);
+        }
         /* roughly one pawn margin for every ply */
         int32_t score_margin = 88 * depth;
-        if (score - score_margin >= beta) {
-            return score - score_margin;
+        if (ss->static_eval - score_margin >= beta) {
+            return ss->static_eval - score_margin;
+        }
+    }
+
+    /* ================================================================== */
+    /* RAZORING: The counterpart of static null move pruning. If we are   */
+    /* at one of the last plies and the static evaluation is so far below */
+    /* alpha that even a margin can't raise it above alpha, only tactical */
+    /* moves can save the position. So we let the quiescence search find  */
+    /* out, and trust it if it confirms the fail-low. We neither razor in */
+    /* pv nodes (where we want exact scores) nor when in check.           */
+    /* ================================================================== */
+    if (searchdata->razor_margin && !pv_node && !ss->in_check && depth <= RAZOR_DEPTH &&
+        ss->static_eval + searchdata->razor_margin * depth <= alpha) {
+        int32_t score = quiesce(searchdata, ply, 0, alpha, beta);
+        if (score <= alpha) {
+            return score;
         }
     }
 
@@ -326,12 +486,96 @@ int32_t pvs(searchdata_t *searchdata, int depth, int ply, int allow_null_move, i
     /* zugzwang. Therefore we dont make null moves if there are only      */
     /* pawns and kings remaining on the board.                            */
     /* ================================================================== */
-    if (allow_null_move && !is_in_check(searchdata->board) && depth >= 3 && !is_lategame(searchdata->board)){
+    if (allow_null_move && !ss->in_check && depth >= 3 && !is_lategame(searchdata->board)){
+        ss->current_move = (move_t){0, 0, 0, 0};
         do_null_move(searchdata->board);
+        /* (the opponent can't be in check, since we were not in check before) */
+        (ss + 1)->in_check = 0;
+        (ss + 1)->reduction = NULL_MOVE_REDUCTION;
+        (ss + 1)->on_pv = 0;
         int32_t score = -pvs(searchdata, depth - 1 - NULL_MOVE_REDUCTION, ply + 1, 0, -beta, -beta + 1);
         undo_null_move(searchdata->board);
         if (score >= beta) {
-            return score;
+            /* (a mate found after passing is no proven mate) */
+            return (score >= MATE_BOUND) ? beta : score;
+        }
+    }
+
+    /* ================================================================== */
+    /* INTERNAL ITERATIVE REDUCTION: Without a move from the table (or    */
+    /* the principal variation), the best move of the node is likely      */
+    /* tried late, which makes searching the node at full depth expen-    */
+    /* sive. So we search it one ply shallower: this gets a best move     */
+    /* into the table cheaply, which the next iteration then tries first  */
+    /* at full depth. The root is always searched at full depth.          */
+    /* ================================================================== */
+    if (depth >= IIR_DEPTH && ply > 0 && !excluded && !(tt_hit && entry.best_move.from != entry.best_move.to) &&
+        !(ss->on_pv && ply < searchdata->root_pv.length)) {
+        depth--;
+    }
+
+    /* ================================================================== */
+    /* PROBCUT: If a good capture (by static exchange evaluation) beats   */
+    /* beta by a margin even with a search reduced by a few plies, the    */
+    /* full depth search would most likely beat beta as well, so we cut   */
+    /* the node off. Each capture is verified by a quiescence search      */
+    /* first, which is much cheaper and drops most of the candidates. We  */
+    /* skip probcut if the table already tells us the node stays below    */
+    /* the raised beta, and near mate scores.                             */
+    /* ================================================================== */
+    int32_t probcut_beta = beta + searchdata->probcut_margin;
+    if (searchdata->probcut_margin && !pv_node && !ss->in_check && !excluded && depth >= PROBCUT_DEPTH &&
+        beta > -MATE_BOUND && probcut_beta < MATE_BOUND &&
+        !(tt_hit && entry.depth >= depth - PROBCUT_REDUCTION + 1 && entry.eval < probcut_beta)) {
+        movelist_t captures;
+        init_movelist(&captures);
+        generate_tactical_moves(searchdata->board, &captures);
+
+        while (has_next(&captures)) {
+            move_t capture = pick_next(&captures);
+            if (!(capture.flags & 0b0100) || see(searchdata->board, capture) < probcut_beta - ss->static_eval) continue;
+
+            ss->current_move = capture;
+            do_move(searchdata->board, capture);
+            (ss + 1)->in_check = is_in_check(searchdata->board);
+            (ss + 1)->reduction = PROBCUT_REDUCTION;
+            (ss + 1)->on_pv = 0;
+            int32_t score = -quiesce(searchdata, ply + 1, 0, -probcut_beta, -probcut_beta + 1);
+            if (score >= probcut_beta) {
+                score = -pvs(searchdata, depth - PROBCUT_REDUCTION, ply + 1, 1, -probcut_beta, -probcut_beta + 1);
+            }
+            undo_move(searchdata->board, capture);
+
+            if (score >= probcut_beta && !search_stopped(&searchdata->timer)) {
+                searchdata->probcut_cutoffs++;
+                store_tt_entry_by_key(searchdata->tt, tt_key, capture, depth - PROBCUT_REDUCTION + 1, score_to_tt(score, ply), LOWERBOUND, ss->static_eval);
+                return score;
+            }
+        }
+    }
+
+    /* ================================================================== */
+    /* SINGULAR EXTENSIONS: If the table move caused a beta cutoff at     */
+    /* (almost) the same depth before, we check whether it is the only    */
+    /* good move: a reduced search without it (at the same ply, see tt_   */
+    /* key) must fail low against a window a bit below the table score.   */
+    /* If it does, all alternatives are clearly worse, the position is    */
+    /* critical and the table move is searched one ply deeper. We neither */
+    /* verify at the root nor with mate scores (whose margin is useless). */
+    /* ================================================================== */
+    int singular = 0;
+    if (depth >= SINGULAR_DEPTH && ply > 0 && !excluded && tt_hit && entry.flags != UPPERBOUND &&
+        entry.depth >= depth - 3 && entry.best_move.from != entry.best_move.to &&
+        entry.eval > -MATE_BOUND && entry.eval < MATE_BOUND) {
+        int32_t singular_beta = entry.eval - SINGULAR_MARGIN * depth;
+        ss->excluded_move = entry.best_move;
+        int32_t score = pvs(searchdata, (depth - 1) / 2, ply, 0, singular_beta - 1, singular_beta);
+        ss->excluded_move = (move_t){0, 0, 0, 0};
+        searchdata->pv[ply].length = 0;
+        searchdata->singular_searches++;
+        if (score < singular_beta) {
+            singular = 1;
+            searchdata->singular_extensions++;
         }
     }
 
@@ -343,40 +587,93 @@ int32_t pvs(searchdata_t *searchdata, int depth, int ply, int allow_null_move, i
     /* the move that maximizes the minimum value of the position          */
     /* resulting from the opponent's possible following moves.            */
     /* ================================================================== */
-    maxpq_t movelst;
+    movepicker_t picker;
     move_t move;
-    initialize_maxpq(&movelst);
-    generate_moves(searchdata->board, &movelst);
-
 
     /* ================================================================== */
-    /* PV-MOVE: We want to order the moves in a way that makes the        */
-    /* search more efficient. We do this by searching the most promising  */
-    /* moves first. The most important move ordering technique is to try  */
+    /* STAGED MOVE GENERATION: Most nodes cut off after the first one or  */
+    /* two moves, so generating (and ordering) all moves up front is      */
+    /* mostly wasted effort. Instead, the move picker hands out the moves */
+    /* in stages and only generates the moves of a stage when reaching it */
+    /* (1) PV-MOVE: The most important move ordering technique is to try  */
     /* PV-Moves first. A PV-Move is part of the principal variation and   */
     /* therefor a best move found in the previous iteration of an         */
-    /* iterative deepening framework.                                     */
-    /* ================================================================== */        
-    if (entry) {
-        for (int i = 1; i <= movelst.nr_elem; i++) {
-            if (is_same_move(movelst.array[i], entry->best_move)) {
-                movelst.array[i].value = 10000;
-                swap(&movelst, i, 1);
-                break;
-            }
-        }
+    /* iterative deepening framework. As long as the path to the node     */
+    /* follows the principal variation, we take the move from it, other-  */
+    /* wise from the transposition table (the best move found whenever    */
+    /* the node was searched before). It is tried before generating any   */
+    /* moves at all.                                                      */
+    /* (2) TACTICAL MOVES: captures (MVV-LVA) and promotions.             */
+    /* (3) KILLER MOVES: quiet moves which caused a beta cutoff in a      */
+    /* sibling node (at the same ply) are likely to do so again.          */
+    /* (4) QUIET MOVES: all remaining moves, ordered by the HISTORY HEUR- */
+    /* ISTIC, i.e. by how often they caused a beta cutoff anywhere in the */
+    /* tree (and how rarely they failed to do so). The COUNTER MOVE, the  */
+    /* quiet move which last refuted the previous move (wherever in the   */
+    /* tree it was played), gets a bonus on top.                          */
+    /* ================================================================== */
+    move_t *counter_move = NULL;
+    if (ply > 0 && (ss - 1)->current_move.from != (ss - 1)->current_move.to) {
+        counter_move = &searchdata->counter_moves[(ss - 1)->current_move.from][(ss - 1)->current_move.to];
     }
+    move_t *pv_move = tt_hit ? &entry.best_move : NULL;
+    if (ss->on_pv && ply < searchdata->root_pv.length) pv_move = &searchdata->root_pv.moves[ply];
+    init_movepicker(&picker, searchdata->board, pv_move, ss->killers, counter_move, &searchdata->history);
+
+    /* quiet moves which did not cause a cutoff (to punish them in the history table) */
+    move_t quiets_tried[MAX_QUIETS_TRIED];
+    int nr_quiets_tried = 0;
 
     int legal_moves = 0;
     int32_t best_score_so_far = NEGINF;
     move_t best_move_so_far = {0,0,0,0};
     int tt_flag = UPPERBOUND;
 
-    while (!is_empty(&movelst)) {
-        move = pop_max(&movelst);
+    /* ================================================================== */
+    /* FUTILITY PRUNING: At the last few plies, if the static evaluation  */
+    /* plus a margin (growing with the depth) does not reach alpha, quiet */
+    /* moves are very unlikely to raise alpha, so we skip them (unless    */
+    /* they give check). Tactical moves are still searched.               */
+    /* LATE MOVE PRUNING: At the last few plies, once enough moves have   */
+    /* been searched, the remaining quiet moves (which are ordered last   */
+    /* by the move picker, i.e. the least promising ones) are skipped.    */
+    /* Neither is done in pv nodes or when in check, and the first move   */
+    /* is always searched.                                                */
+    /* ================================================================== */
+    int32_t futility_value = ss->static_eval + searchdata->futility_margin * depth;
+    int futile = searchdata->futility_margin && !pv_node && !ss->in_check && depth <= FUTILITY_DEPTH &&
+                 futility_value <= alpha;
+    int lmp_moves = (searchdata->lmp_base && !pv_node && !ss->in_check && depth <= LMP_DEPTH) ?
+                    searchdata->lmp_base + depth * depth : INT_MAX;
+
+    while (next_move(&picker, &move)) {
+        if (excluded && is_same_move(move, ss->excluded_move)) continue;
         legal_moves++;
 
+        int quiet = !(move.flags & 0b1100);
+        if (quiet && legal_moves > lmp_moves && best_score_so_far > -MATE_BOUND) {
+            continue;
+        }
+
+        /* the child will probe the table first, so we start fetching its cluster */
+        /* from memory already, while the move is being executed (children at the */
+        /* horizon go straight into quiescence search, which does not probe) */
+        if (depth > 1) prefetch_tt_entry(searchdata->tt, hash_after_move(searchdata->board, move));
+        ss->current_move = move;
         do_move(searchdata->board, move);
+        (ss + 1)->in_check = is_in_check(searchdata->board);
+        (ss + 1)->reduction = 0;
+        (ss + 1)->on_pv = ss->on_pv && ply < searchdata->root_pv.length && is_same_move(move, searchdata->root_pv.moves[ply]);
+
+        /* depth of the child (one ply more for a singular move) */
+        int new_depth = depth - 1 + (singular && is_same_move(move, entry.best_move));
+
+        /* (the futility value is an upper bound for the skipped move) */
+        if (futile && quiet && legal_moves > 1 && !(ss + 1)->in_check) {
+            undo_move(searchdata->board, move);
+            if (futility_value > best_score_so_far) best_score_so_far = futility_value;
+            continue;
+        }
         
         /* ================================================================== */
         /* PRINCIPAL VARIATION SEARCH: PVS produces more cutoffs than alpha–  */
@@ -391,7 +688,7 @@ int32_t pvs(searchdata_t *searchdata, int depth, int ply, int allow_null_move, i
         int32_t score;
         if(legal_moves == 1){
             /* search the first (assumed to be the best) move with full window */
-            score = -pvs(searchdata, depth - 1, ply + 1, 1, -beta, -alpha);
+            score = -pvs(searchdata, new_depth, ply + 1, 1, -beta, -alpha);
         } else {
             /* ================================================================== */
             /* LATE MOVE REDUCTION: Late move reduction is a technique that tries */
@@ -400,30 +697,47 @@ int32_t pvs(searchdata_t *searchdata, int depth, int ply, int allow_null_move, i
             /* ves which are searched later in search are more likely to be bad   */
             /* moves, (since our move ordering is good) and therefore we can red- */
             /* uce the depth of the search. For one, we do not want to reduce the */
-            /* search depth for tactical moves, i.e. captures, promotions and     */
-            /* when in check, and neither for pv moves (since they are likely the */
-            /* best) nor for depths less than 3 (since we want to search at least */
-            /* 3 plies).                                                          */
+            /* search depth for tactical moves, i.e. captures and promotions, nor */
+            /* for depths less than 3 (since we want to search at least 3 plies). */
+            /* The reduction grows logarithmically with both the depth and the    */
+            /* move number (see lmr_table), and is lowered in pv nodes (where we  */
+            /* want exact scores), for moves giving check and for moves with a    */
+            /* good history score (and raised for ones with a bad score). The     */
+            /* reduced search never drops into quiescence search directly.        */
             /* ================================================================== */
             int reduction = 0;
-            if(legal_moves >= 4 && depth >= 3 && !(move.flags & 0b1100) && !is_in_check(searchdata->board)){
-                reduction = 1;
+            if (depth >= 3 && !(move.flags & 0b1100)) {
+                reduction = lmr_table[depth][legal_moves < LMR_MAX_MOVES ? legal_moves : LMR_MAX_MOVES - 1];
+                if (pv_node) reduction--;
+                if ((ss + 1)->in_check) reduction--;
+                reduction -= searchdata->history[SWITCHSIDES(searchdata->board->player)][move.from][move.to] / (HISTORY_MAX / 2);
+                if (reduction > depth - 2) reduction = depth - 2;
+                if (reduction < 0) reduction = 0;
             }
+            (ss + 1)->reduction = reduction;
 
             /* search the remaining moves with a null window */
-            score = -pvs(searchdata, depth - 1 - reduction, ply + 1, 1, -alpha - 1, -alpha);
-            
+            score = -pvs(searchdata, new_depth - reduction, ply + 1, 1, -alpha - 1, -alpha);
+            if (reduction > 0) searchdata->lmr_searches++;
+
             /* ================================================================== */
-            /* RE-SEARCH: if the score lies within the window of alpha and beta,  */
-            /* i.e. would increase alpha, search again with full window and full  */
-            /* depth, since our hypothesis that the pv-move is the best move      */
-            /* is false. Hence, we want to be sure that the move is actually bet- */
-            /* ter. If the score is greater than alpha (and!) beta we do not      */
-            /* search again, because we assume the node would have lead to a beta */
-            /* cutoff.                                                            */
+            /* RE-SEARCH: if a reduced search raises alpha, we do not trust it    */
+            /* and search the move again with full depth (but still with a null   */
+            /* window). If the score then lies within the window of alpha and     */
+            /* beta, i.e. would increase alpha, search again with full window,    */
+            /* since our hypothesis that the pv-move is the best move is false.   */
+            /* Hence, we want to be sure that the move is actually better. If the */
+            /* score is greater than alpha (and!) beta we do not search again,    */
+            /* because we assume the node would have lead to a beta cutoff.       */
             /* ================================================================== */
+            if (reduction > 0 && score > alpha) {
+                searchdata->lmr_researches++;
+                (ss + 1)->reduction = 0;
+                score = -pvs(searchdata, new_depth, ply + 1, 1, -alpha - 1, -alpha);
+            }
             if(score > alpha && score < beta){
-                score = -pvs(searchdata, depth - 1, ply + 1, 1, -beta, -alpha);
+                (ss + 1)->reduction = 0;
+                score = -pvs(searchdata, new_depth, ply + 1, 1, -beta, -alpha);
             }
         }
 
@@ -438,24 +752,47 @@ int32_t pvs(searchdata_t *searchdata, int depth, int ply, int allow_null_move, i
         if (best_score_so_far > alpha) { 
             alpha = best_score_so_far;
             tt_flag = EXACT; 
+
+            /* ================================================================== */
+            /* TRIANGULAR PV TABLE: The principal variation of the node is the    */
+            /* move which raised alpha, followed by the principal variation of    */
+            /* the child it leads to (which is still in the table, since no       */
+            /* other child was searched since).                                   */
+            /* ================================================================== */
+            pv_line_t *pv = &searchdata->pv[ply], *child_pv = &searchdata->pv[ply + 1];
+            pv->moves[0] = move;
+            for (int i = 0; i < child_pv->length; i++) pv->moves[i + 1] = child_pv->moves[i];
+            pv->length = child_pv->length + 1;
         }
 
         /* beta cutoff */
         if (alpha >= beta) {
-            /* if there are still moves left, we only know that the best score
-               so far is a lowerbound for the true score */
-            if (!is_empty(&movelst)) {
-                tt_flag = LOWERBOUND;
-            } 
+            /* we only know that the best score so far is a lowerbound for the true score */
+            tt_flag = LOWERBOUND;
+
+            searchdata->fail_high++;
+            if (legal_moves == 1) searchdata->fail_high_first++;
+
+            if (!(move.flags & 0b1100)) {
+                update_quiet_stats(searchdata, depth, ply, move, quiets_tried, nr_quiets_tried);
+            }
             break;
         }
+
+        if (!(move.flags & 0b1100) && nr_quiets_tried < MAX_QUIETS_TRIED) {
+            quiets_tried[nr_quiets_tried++] = move;
+        }
     }
 
     /* if the player had no legal moves, the game is over (atleast in this branch of the search) */
     if (legal_moves == 0) {
+        /* without the excluded move there might be no moves left, which makes it singular */
+        if (excluded) {
+            return alpha;
+        }
         /* we wan't to determine if the player was check mated */
-        if (is_in_check(searchdata->board)) {
-            return NEGINF + depth;
+        if (ss->in_check) {
+            return NEGINF + ply;
         }
         /* or if we reached a stalemate */
         else {
@@ -473,14 +810,58 @@ int32_t pvs(searchdata_t *searchdata, int depth, int ply, int allow_null_move, i
     /* expiration (since we cant be sure that the information is truely */
     /* correct).                                                        */
     /* ================================================================ */
-    if (searchdata->timer.stop != 1) {
-        store_tt_entry(searchdata->tt, searchdata->board, best_move_so_far, depth, best_score_so_far, tt_flag);
+    if (!search_stopped(&searchdata->timer)) {
+        store_tt_entry_by_key(searchdata->tt, tt_key, best_move_so_far, depth, score_to_tt(best_score_so_far, ply), tt_flag, ss->static_eval);
+
+        /* remember the root move of this thread (the table entry might be overwritten by other threads) */
+        if (ply == 0) {
+            searchdata->root_best_move = best_move_so_far;
+            searchdata->root_pv = searchdata->pv[0];
+        }
     }
 
     /* return best score (not alpha! a.k.a. fail-soft variation) */
     return best_score_so_far;
 }
 
+/* ================================================================== */
+/* LAZY SMP: Helper threads run the same iterative deepening loop as  */
+/* the main thread on their own copy of the board, but share the      */
+/* transposition table with it. They do not report anything, their   */
+/* only purpose is to fill the table with results the main thread can */
+/* use. To make the threads diverge, every second helper starts one   */
+/* iteration deeper than the main thread.                             */
+/* ================================================================== */
+void *helper_search(void *args) {
+    searchdata_t *searchdata = (searchdata_t *)args;
+
+    int alpha = NEGINF, beta = INF;
+    for (int depth = 1 + (searchdata->thread_id & 1); depth < MAXDEPTH; depth++) {
+        int eval = pvs(searchdata, depth, 0, 1, alpha, beta);
+
+        if (search_stopped(&searchdata->timer)) break;
+
+        /* aspiration windows, see search() */
+        if (eval <= alpha || eval >= beta) {
+            alpha = NEGINF;
+            beta = INF;
+            depth--;
+            continue;
+        }
+        alpha = eval - WINDOWSIZE;
+        beta = eval + WINDOWSIZE;
+    }
+
+    return NULL;
+}
+
+/* returns the amount of nodes searched by all threads */
+uint64_t nodes_searched_by_all(searchdata_t *searchdata, searchdata_t **helpers, int nr_helpers) {
+    uint64_t nodes = searchdata->nodes_searched;
+    for (int i = 0; i < nr_helpers; i++) nodes += helpers[i]->nodes_searched;
+    return nodes;
+}
+
 void search(searchdata_t *searchdata) {
     /* Reset the history hash table from prevoius searches */
     /* Of course we keep the board hashes of already played positions untouched */
@@ -494,8 +875,31 @@ void search(searchdata_t *searchdata) {
     searchdata->hash_used = 0;
     searchdata->hash_bounds_adjusted = 0;
     searchdata->pv_node_hit = 0;
+    searchdata->fail_high = 0;
+    searchdata->fail_high_first = 0;
+    searchdata->pawn_table.probes = 0;
+    searchdata->pawn_table.hits = 0;
+    searchdata->eval_cache.probes = 0;
+    searchdata->eval_cache.hits = 0;
+    searchdata->tt_static_evals = 0;
+    searchdata->lazy_evals = 0;
+    searchdata->lmr_searches = 0;
+    searchdata->lmr_researches = 0;
+    searchdata->singular_searches = 0;
+    searchdata->singular_extensions = 0;
+    searchdata->probcut_cutoffs = 0;
+    searchdata->root_pv.length = 0;
     searchdata->timer.time_available = calculate_time(searchdata);
 
+    /* start the helper threads (if any) */
+    int nr_helpers = (searchdata->nr_threads > MAXTHREADS ? MAXTHREADS : searchdata->nr_threads) - 1;
+    searchdata_t *helpers[MAXTHREADS];
+    pthread_t helper_threads[MAXTHREADS];
+    for (int i = 0; i < nr_helpers; i++) {
+        helpers[i] = init_helper_data(searchdata, i + 1);
+        pthread_create(&helper_threads[i], NULL, helper_search, (void *)helpers[i]);
+    }
+
     int alpha = NEGINF, beta = INF;
 
     /* =================================================================== */
@@ -503,13 +907,13 @@ void search(searchdata_t *searchdata) {
     /* to search to a given depth, that iterative deepening is faster than */
     /* searching for the given depth immediately. This is due to dynamic   */
     /* move ordering techniques such as; PV- and hash- moves determined in */
-    /* previous iteration(s), as well the history heuristic (TODO).        */
+    /* previous iteration(s), as well as killer moves and the history.     */
     /* =================================================================== */
     for (int depth = 1; depth <= searchdata->timer.max_depth && depth < MAXDEPTH;
          depth++) {
         int eval = pvs(searchdata, depth, 0, 1, alpha, beta);
 
-        if (searchdata->timer.stop == 1) {
+        if (search_stopped(&searchdata->timer)) {
             if (searchdata->best_move == NULL && depth == 1) {
                 searchdata->best_move = tt_best_move(searchdata->tt, searchdata->board);
             }
@@ -538,25 +942,85 @@ void search(searchdata_t *searchdata) {
 
         /* Update search data and output info (for GUI) */
         if(searchdata->best_move) free(searchdata->best_move);
-        searchdata->best_move = tt_best_move(searchdata->tt, searchdata->board);
+        searchdata->best_move = copy_move(&searchdata->root_best_move);
         searchdata->best_eval = eval;
 
-        int nodes = searchdata->nodes_searched;
+        int nodes = nodes_searched_by_all(searchdata, helpers, nr_helpers);
         int seldepth = searchdata->max_seldepth;
         int delta = delta_in_ms(searchdata);
         if(delta == 0) delta = 1;
         int nps = (int)(nodes / delta) * 1000;
         int time = delta;
         int hashfull = tt_permille_full(searchdata->tt);
-        char *score = get_mate_or_cp_value(eval, searchdata->depth_with_ext);
+        char *score = get_mate_or_cp_value(eval);
 
         printf("info score %s depth %d seldepth %d nodes %d time %d nps %d hasfull %d pv ",
                score, depth, seldepth, nodes, time, nps, hashfull);
-        print_line(searchdata->tt, searchdata->board, depth);
+        /* the pv is taken from our own pv table, so it is exact (whatever helper threads */
+        /* wrote into the transposition table) */
+        player_t player = searchdata->board->player;
+        for (int i = 0; i < searchdata->root_pv.length; i++) {
+            print_LAN_move(searchdata->root_pv.moves[i], player);
+            printf(" ");
+            player = SWITCHSIDES(player);
+        }
         printf("\n");
-        if (eval >= INF - MAXDEPTH || eval <= NEGINF + MAXDEPTH) break;
-
         free(score);
+
+        /* once a mate is found, deeper iterations could only find a shorter one */
+        if (eval >= MATE_BOUND || eval <= -MATE_BOUND) break;
+    }
+
+    /* stop and wait for the helper threads */
+    for (int i = 0; i < nr_helpers; i++) stop_search(&helpers[i]->timer);
+    for (int i = 0; i < nr_helpers; i++) {
+        pthread_join(helper_threads[i], NULL);
+        searchdata->nodes_searched += helpers[i]->nodes_searched;
+        searchdata->pawn_table.probes += helpers[i]->pawn_table.probes;
+        searchdata->pawn_table.hits += helpers[i]->pawn_table.hits;
+        searchdata->eval_cache.probes += helpers[i]->eval_cache.probes;
+        searchdata->eval_cache.hits += helpers[i]->eval_cache.hits;
+        searchdata->tt_static_evals += helpers[i]->tt_static_evals;
+        searchdata->lazy_evals += helpers[i]->lazy_evals;
+        searchdata->lmr_searches += helpers[i]->lmr_searches;
+        searchdata->lmr_researches += helpers[i]->lmr_researches;
+        searchdata->singular_searches += helpers[i]->singular_searches;
+        searchdata->singular_extensions += helpers[i]->singular_extensions;
+        searchdata->probcut_cutoffs += helpers[i]->probcut_cutoffs;
+        free_helper_data(helpers[i]);
+    }
+
+    /* report how well the pawn hash table worked (not used by the network evaluation) */
+    if (searchdata->pawn_table.probes > 0) {
+        printf("info string pawn hash hit rate %.2f%% (%llu probes)\n",
+               100.0 * searchdata->pawn_table.hits / searchdata->pawn_table.probes,
+               (unsigned long long) searchdata->pawn_table.probes);
+    }
+
+    /* report how often evaluating could be skipped thanks to the evaluation cache and the table */
+    if (searchdata->eval_cache.probes > 0) {
+        printf("info string eval cache hit rate %.2f%% (%llu probes), %llu static evals from the hash table\n",
+               100.0 * searchdata->eval_cache.hits / searchdata->eval_cache.probes,
+               (unsigned long long) searchdata->eval_cache.probes, (unsigned long long) searchdata->tt_static_evals);
+    }
+    if (searchdata->lazy_evals > 0) {
+        printf("info string %llu lazy evaluations in quiescence search\n", (unsigned long long) searchdata->lazy_evals);
+    }
+
+    /* report how often reduced searches failed high (and had to be searched again with full depth) */
+    if (searchdata->lmr_searches > 0) {
+        printf("info string %llu reduced searches, %.2f%% of them re-searched\n",
+               (unsigned long long) searchdata->lmr_searches,
+               100.0 * searchdata->lmr_researches / searchdata->lmr_searches);
+    }
+
+    /* report how often the table move turned out to be singular (and was extended) */
+    if (searchdata->singular_searches > 0) {
+        printf("info string %llu singular extensions in %llu verification searches\n",
+               (unsigned long long) searchdata->singular_extensions, (unsigned long long) searchdata->singular_searches);
+    }
+    if (searchdata->probcut_cutoffs > 0) {
+        printf("info string %llu probcut cutoffs\n", (unsigned long long) searchdata->probcut_cutoffs);
     }
 
     int nodes = searchdata->nodes_searched;
@@ -1,3 +1,4 @@
+#include <string.h>
 #include <sys/time.h>
 
 #include "include/engine-core/search.h"
@@ -106,7 +107,7 @@ void check_time(search_timer_t* timer) {
     /* if search is not in infinite mode and the time has run out, stop search immediately */
     if (!timer->run_infinite) {
         if (!time_left(timer->start, timer->time_available)) {
-            timer->stop = 1;
+            stop_search(timer);
         }
     }
 }
@@ -141,19 +142,35 @@ search_timer_t init_timer(int local_lag, int remote_lag) {
 }
 
 /* initializes search data structure */
-searchdata_t *init_search_data(board_t *board, int tt_size_in_mb, int local_lag, int remote_lag) {
+searchdata_t *init_search_data(board_t *board, tt_t tt, int nr_threads, int local_lag, int remote_lag) {
     searchdata_t *data = (searchdata_t *)malloc(sizeof(searchdata_t));
 
     data->board = copy_board(board);                    /* pointer to the actual board */
-    data->tt = init_tt(MB_TO_BYTES(tt_size_in_mb));     /* transposition table for the search */
+    data->tt = tt;                                      /* transposition table for the search */
+
+    data->thread_id = 0;                                /* the main thread always has id 0 */
+    data->nr_threads = nr_threads;                      /* number of threads searching in parallel */
 
     data->timer = init_timer(local_lag, remote_lag);    /* timer for time management */
 
     data->ponder = 0;                                   /* tells engine to start search at ponder move */
+    data->lazy_eval_margin = LAZY_EVAL_MARGIN;          /* margin outside the window for lazy evaluation */
+    data->futility_margin = FUTILITY_MARGIN;            /* futility pruning margin per ply */
+    data->razor_margin = RAZOR_MARGIN;                  /* razoring margin per ply */
+    data->lmp_base = LMP_BASE;                          /* moves searched before late move pruning starts */
+    data->probcut_margin = PROBCUT_MARGIN;              /* margin above beta for probcut */
+    data->qsearch_checks = QSEARCH_CHECKS;              /* search quiet checks in the first quiescence ply */
 
     data->depth_with_ext = 0;                           /* tracks the "actual" depth of search i.e. with extensions */
     data->max_seldepth = -1;                            /* maximum depth searched while in quiescence search */
     data->best_move = NULL;                             /* best move in (iterative) search so far */
+    data->root_best_move = (move_t){0, 0, 0, 0};        /* best root move of this thread in the last iteration */
+    data->root_pv.length = 0;                           /* principal variation of this thread in the last iteration */
+    memset(data->history, 0, sizeof(history_t));                    /* history heuristic */
+    memset(data->counter_moves, 0, sizeof(data->counter_moves));    /* counter move heuristic */
+    memset(data->stack, 0, sizeof(data->stack));                    /* search path (moves, killers etc.) */
+    data->pawn_table = init_pawn_table();               /* cached pawn structure evaluations */
+    data->eval_cache = init_eval_cache();               /* cached static evaluations */
     data->best_eval = NEGINF;                           /* corresponding evaluation of best move */
     data->nodes_searched = 0;                           /* amount of nodes searched */
     data->hash_used = 0;                                /* amount of hash entries that lead to not */
@@ -161,13 +178,71 @@ searchdata_t *init_search_data(board_t *board, int tt_size_in_mb, int local_lag,
     data->hash_bounds_adjusted = 0;                     /* amount of hash entries that lead to */
                                                         /* adjustment of alpha/beta bounds */
     data->pv_node_hit = 0;                              /* amount of pv moves that turned out to be the best move */
+    data->fail_high = 0;                                /* amount of beta cutoffs */
+    data->fail_high_first = 0;                          /* amount of beta cutoffs caused by the first move */
+    data->tt_static_evals = 0;                          /* amount of static evaluations taken from the table */
+    data->lazy_evals = 0;                               /* amount of evaluations decided by the estimate alone */
+    data->lmr_searches = 0;                             /* amount of searches reduced by late move reduction */
+    data->lmr_researches = 0;                           /* amount of reduced searches which were searched again */
+    data->singular_searches = 0;                        /* amount of singular extension verification searches */
+    data->singular_extensions = 0;                      /* amount of singular extensions */
+    data->probcut_cutoffs = 0;                          /* amount of nodes cut off by probcut */
     return data;
 }
 
-/* frees search data structure */
+/* frees search data structure (the table is owned by the caller) */
 void free_search_data(searchdata_t *data) {
-    free(data->board);
-    free_tt(data->tt);
+    free_board(data->board);
+    free_pawn_table(&data->pawn_table);
+    free_eval_cache(&data->eval_cache);
+    free_move(data->best_move);
+    free(data);
+}
+
+/* initializes search data structure of a helper thread */
+searchdata_t *init_helper_data(searchdata_t *main_data, int thread_id) {
+    searchdata_t *data = (searchdata_t *)malloc(sizeof(searchdata_t));
+
+    /* every helper searches its own copy of the board, but all threads share the same table */
+    *data = *main_data;
+    data->board = copy_board(main_data->board);
+    data->thread_id = thread_id;
+    data->pawn_table = init_pawn_table();
+    data->eval_cache = init_eval_cache();
+
+    /* helpers search until the main thread tells them to stop */
+    data->timer.run_infinite = 1;
+    data->timer.max_depth = MAXDEPTH;
+    data->timer.max_nodes = 18446744073709551615ULL;
+    data->timer.stop = 0;
+
+    data->depth_with_ext = 0;
+    data->max_seldepth = -1;
+    data->best_move = NULL;
+    data->root_best_move = (move_t){0, 0, 0, 0};
+    data->root_pv.length = 0;
+    data->best_eval = NEGINF;
+    data->nodes_searched = 0;
+    data->hash_used = 0;
+    data->hash_bounds_adjusted = 0;
+    data->pv_node_hit = 0;
+    data->fail_high = 0;
+    data->fail_high_first = 0;
+    data->tt_static_evals = 0;
+    data->lazy_evals = 0;
+    data->lmr_searches = 0;
+    data->lmr_researches = 0;
+    data->singular_searches = 0;
+    data->singular_extensions = 0;
+    data->probcut_cutoffs = 0;
+    return data;
+}
+
+/* frees search data structure of a helper thread (the table is owned by the main thread) */
+void free_helper_data(searchdata_t *data) {
+    free_board(data->board);
+    free_pawn_table(&data->pawn_table);
+    free_eval_cache(&data->eval_cache);
     free_move(data->best_move);
     free(data);
 }
@@ -1,5 +1,12 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 
 #include "include/engine-core/tt.h"
 
@@ -7,6 +14,7 @@
 #include "include/engine-core/types.h"
 #include "include/engine-core/move.h"
 #include "include/engine-core/prettyprint.h"
+#include "include/engine-core/zobrist.h"
 
 
 /* ------------------------------------------------------------------------------------------------ */
@@ -40,116 +48,336 @@ uint64_t hash_func_tt(uint64_t key, int bits) {
 /* ------------------------------------------------------------------------------------------------ */
 
 
-/* allocates memory for and initializes a transposition table */
-tt_t init_tt(int size_in_bytes) {
+/* returns the number of clusters fitting into the given size (rounded down to a power of two) */
+int nr_of_clusters(uint64_t size_in_bytes) {
     /* check if size is too small */
-    if(size_in_bytes < (int) (sizeof(tt_bucket_t))){
+    if(size_in_bytes < sizeof(tt_cluster_t)){
         fprintf(stderr, "ERROR: transposition table size is too small\n");
         exit(EXIT_FAILURE);
     }
+    return round_to_power_of_two((uint32_t) (size_in_bytes / sizeof(tt_cluster_t)));
+}
 
-    /* calculate number of buckets */
-    int nr_of_buckets =
-        size_in_bytes /
-        (sizeof(
-            tt_bucket_t)); /* memory for every bucket (two entry pointers) */
+/* allocates memory for the clusters, backed by (transparent) huge pages if available */
+tt_cluster_t* allocate_clusters(uint64_t size_in_bytes) {
+    /* tables spanning atleast one huge page are aligned to huge pages, so the kernel can back */
+    /* them with huge pages (every probe then hits the tlb), smaller ones only to cache lines */
+    size_t alignment = (size_in_bytes >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+    tt_cluster_t* clusters = (tt_cluster_t*) aligned_alloc(alignment, size_in_bytes);
+    if(!clusters){
+        fprintf(stderr, "ERROR: could not allocate transposition table\n");
+        exit(EXIT_FAILURE);
+    }
 
-    /* round (down) nr of buckets to power of two */
-    nr_of_buckets = round_to_power_of_two(nr_of_buckets);
+    #ifdef MADV_HUGEPAGE
+    /* if transparent huge pages are disabled this fails, and we simply keep the normal pages */
+    if(alignment == HUGE_PAGE_SIZE) madvise(clusters, size_in_bytes, MADV_HUGEPAGE);
+    #endif
 
-    /* allocate memory for transposition table */
+    return clusters;
+}
+
+/* arguments of a thread clearing a part of the table */
+typedef struct _tt_clear_args_t {
+    char* start;
+    uint64_t size_in_bytes;
+} tt_clear_args_t;
+
+/* clears a part of the table */
+void* clear_tt_part(void* args) {
+    tt_clear_args_t* clear_args = (tt_clear_args_t*) args;
+    memset(clear_args->start, 0, clear_args->size_in_bytes);
+    return NULL;
+}
+
+/* clears the clusters, splitting the work among as many threads as there are cores */
+void clear_clusters(tt_cluster_t* clusters, uint64_t size_in_bytes) {
+    /* every thread clears atleast TT_CLEAR_MIN_SIZE bytes, for small tables threads are not worth it */
+    long nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(nr_threads > MAXTHREADS) nr_threads = MAXTHREADS;
+    if(nr_threads > (long) (size_in_bytes / TT_CLEAR_MIN_SIZE)) nr_threads = size_in_bytes / TT_CLEAR_MIN_SIZE;
+    if(nr_threads < 1) nr_threads = 1;
+
+    pthread_t threads[MAXTHREADS];
+    tt_clear_args_t args[MAXTHREADS];
+    uint64_t part_size = size_in_bytes / nr_threads;
+    for(int i = 0; i < nr_threads; i++) {
+        args[i].start = (char*) clusters + i * part_size;
+        args[i].size_in_bytes = (i == nr_threads - 1) ? size_in_bytes - i * part_size : part_size;
+    }
+
+    /* the calling thread clears the first part itself */
+    for(int i = 1; i < nr_threads; i++) pthread_create(&threads[i], NULL, clear_tt_part, &args[i]);
+    clear_tt_part(&args[0]);
+    for(int i = 1; i < nr_threads; i++) pthread_join(threads[i], NULL);
+}
+
+/* allocates memory for and initializes a transposition table */
+tt_t init_tt(uint64_t size_in_bytes) {
     tt_t table;
-    table.size = nr_of_buckets;
+    table.size = nr_of_clusters(size_in_bytes);
     table.no_bits = find_power_of_two(table.size);
-    table.buckets = (tt_bucket_t*) malloc(nr_of_buckets * sizeof(tt_bucket_t));
+    table.generation = 0;
+    table.header = NULL;
+    table.fd = -1;
+    table.clusters = allocate_clusters((uint64_t) table.size * sizeof(tt_cluster_t));
 
-    /* initialize every bucket */
-    memset(table.buckets, 0, nr_of_buckets * sizeof(tt_bucket_t));
+    /* initialize every cluster */
+    clear_clusters(table.clusters, (uint64_t) table.size * sizeof(tt_cluster_t));
+
+    return table;
+}
+
+/* returns the size of the backing file of a table */
+uint64_t tt_file_size(tt_t table) {
+    return sizeof(tt_file_header_t) + (uint64_t) table.size * sizeof(tt_cluster_t);
+}
+
+/* maps the backing file (table.fd) of a table into memory, returns 1 on success */
+/* if the file holds a compatible table of the same size, its entries are kept, otherwise it is cleared */
+int map_tt_file(tt_t* table) {
+    uint64_t file_size = tt_file_size(*table);
+
+    /* a compatible file has exactly the size of the table */
+    struct stat file_stat;
+    if(fstat(table->fd, &file_stat) != 0) return 0;
+    int compatible = ((uint64_t) file_stat.st_size == file_size);
+    if(!compatible && ftruncate(table->fd, file_size) != 0) return 0;
+
+    void* mapping = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, table->fd, 0);
+    if(mapping == MAP_FAILED) return 0;
+    table->header = (tt_file_header_t*) mapping;
+    table->clusters = (tt_cluster_t*) (table->header + 1);
+
+    /* entries are only of use if they were stored in the same format and with the same zobrist keys */
+    compatible = compatible &&
+                 table->header->magic == TT_FILE_MAGIC &&
+                 table->header->version == TT_FILE_VERSION &&
+                 table->header->cluster_size == sizeof(tt_cluster_t) &&
+                 table->header->zobrist_seed == zobrist_table.seed &&
+                 table->header->size == (uint64_t) table->size;
+
+    if(compatible) {
+        table->generation = table->header->generation;
+    } else {
+        /* clear the clusters before writing the header, so an interrupted clear can't leave a valid file */
+        table->header->magic = 0;
+        clear_clusters(table->clusters, (uint64_t) table->size * sizeof(tt_cluster_t));
+        table->header->version = TT_FILE_VERSION;
+        table->header->cluster_size = sizeof(tt_cluster_t);
+        table->header->zobrist_seed = zobrist_table.seed;
+        table->header->size = table->size;
+        table->header->generation = table->generation = 0;
+        table->header->magic = TT_FILE_MAGIC;
+    }
+    return 1;
+}
+
+/* opens (or creates) a transposition table backed by a memory-mapped file, keeping the entries */
+/* stored in it if the file is compatible (falls back to a table in memory if the file can't be used) */
+tt_t init_tt_file(char* path, uint64_t size_in_bytes) {
+    tt_t table;
+    table.size = nr_of_clusters(size_in_bytes);
+    table.no_bits = find_power_of_two(table.size);
+    table.generation = 0;
+    table.fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if(table.fd < 0 || !map_tt_file(&table)) {
+        fprintf(stderr, "ERROR: could not map transposition table file '%s', using memory only\n", path);
+        if(table.fd >= 0) close(table.fd);
+        return init_tt(size_in_bytes);
+    }
 
     return table;
 }
 
 /* frees memory of transposition table */
 void free_tt(tt_t table) {
-    free(table.buckets);
+    if(table.header) {
+        /* unmapping writes the table back to its file */
+        munmap(table.header, tt_file_size(table));
+        close(table.fd);
+    } else {
+        free(table.clusters);
+    }
 }
 
 /* resets the transposition table */
 void reset_tt(tt_t table) {
-    memset(table.buckets, 0, table.size * sizeof(tt_bucket_t));
+    clear_clusters(table.clusters, (uint64_t) table.size * sizeof(tt_cluster_t));
 }
 
+/* resizes the transposition table (if the number of clusters stays the same, all entries are kept) */
+void resize_tt(tt_t* table, uint64_t size_in_bytes) {
+    int size = nr_of_clusters(size_in_bytes);
+    if(size == table->size) return;
+
+    /* a file-backed table is resized together with its file */
+    if(table->header) {
+        munmap(table->header, tt_file_size(*table));
+        table->size = size;
+        table->no_bits = find_power_of_two(size);
+        if(!map_tt_file(table)) {
+            fprintf(stderr, "ERROR: could not resize transposition table file, using memory only\n");
+            close(table->fd);
+            *table = init_tt(size_in_bytes);
+        }
+        return;
+    }
+
+    free(table->clusters);
+    table->size = size;
+    table->no_bits = find_power_of_two(size);
+    table->clusters = allocate_clusters((uint64_t) size * sizeof(tt_cluster_t));
+    clear_clusters(table->clusters, (uint64_t) size * sizeof(tt_cluster_t));
+}
+
+/* starts a new generation of entries (has to be called before every new search) */
+void age_tt(tt_t* table) {
+    table->generation = (table->generation + 1) % TT_GENERATIONS;
+    if(table->header) table->header->generation = table->generation;
+}
 
 /* ------------------------------------------------------------------------------------------------ */
 /* functions for storing and retrieving of transposition table entries                              */
 /* ------------------------------------------------------------------------------------------------ */
 
 
-/* stores an entry in transposition table */
-void store_tt_entry(tt_t table, board_t* board, move_t move, int8_t depth, int32_t eval, int8_t flags) {
+/* packs move, depth, eval, flags, generation and static eval of an entry into a single 64-bit word */
+/* layout: move (16 bits) | eval (16 bits) | depth (8 bits) | flags (2 bits) | generation (6 bits) | static eval (16 bits) */
+uint64_t pack_tt_data(move_t move, int8_t depth, int32_t eval, int8_t flags, uint8_t generation, int32_t static_eval) {
+    return ((uint64_t)move.from & 0x3F) |
+           (((uint64_t)move.to & 0x3F) << 6) |
+           (((uint64_t)move.flags & 0xF) << 12) |
+           ((uint64_t)(uint16_t)eval << 16) |
+           ((uint64_t)(uint8_t)depth << 32) |
+           (((uint64_t)flags & 0x3) << 40) |
+           (((uint64_t)generation & 0x3F) << 42) |
+           ((uint64_t)(uint16_t)static_eval << 48);
+}
+
+/* unpacks a 64-bit data word into an entry */
+void unpack_tt_data(uint64_t key, uint64_t data, tt_entry_t* entry) {
+    entry->key = key;
+    entry->best_move.value = 0;
+    entry->best_move.from = data & 0x3F;
+    entry->best_move.to = (data >> 6) & 0x3F;
+    entry->best_move.flags = (data >> 12) & 0xF;
+    entry->eval = (int16_t)(uint16_t)(data >> 16);
+    entry->depth = (int8_t)(uint8_t)(data >> 32);
+    entry->flags = (data >> 40) & 0x3;
+    entry->static_eval = (int16_t)(uint16_t)(data >> 48);
+}
+
+/* returns the depth stored in a data word */
+int8_t tt_data_depth(uint64_t data) {
+    return (int8_t)(uint8_t)(data >> 32);
+}
+
+/* returns the generation stored in a data word */
+uint8_t tt_data_generation(uint64_t data) {
+    return (data >> 42) & 0x3F;
+}
+
+/* returns how worthy a slot is to be kept, i.e. deep entries of recent searches are worth the most */
+int tt_data_worth(tt_t table, uint64_t data) {
+    int age = (TT_GENERATIONS + table.generation - tt_data_generation(data)) % TT_GENERATIONS;
+    return tt_data_depth(data) - TT_AGE_WEIGHT * age;
+}
+
+/* writes a slot (the two words might be torn apart by concurrent writers, see tt_slot_t) */
+void write_tt_slot(tt_slot_t* slot, uint64_t key, uint64_t data) {
+    __atomic_store_n(&slot->key, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->data, data, __ATOMIC_RELAXED);
+}
+
+/* reads a slot, returns 1 (and the data word) if it holds an intact entry for the given key */
+int read_tt_slot(tt_slot_t* slot, uint64_t key, uint64_t* data) {
+    uint64_t stored_key = __atomic_load_n(&slot->key, __ATOMIC_RELAXED);
+    *data = __atomic_load_n(&slot->data, __ATOMIC_RELAXED);
+    return (stored_key ^ *data) == key;
+}
+
+/* stores an entry in transposition table (static_eval is TT_NO_EVAL if the position was not evaluated) */
+void store_tt_entry(tt_t table, board_t* board, move_t move, int8_t depth, int32_t eval, int8_t flags, int32_t static_eval) {
+    store_tt_entry_by_key(table, board->hash, move, depth, eval, flags, static_eval);
+}
+
+/* stores an entry under the given key (e.g. a variant of the position's zobrist key) */
+void store_tt_entry_by_key(tt_t table, uint64_t key, move_t move, int8_t depth, int32_t eval, int8_t flags, int32_t static_eval) {
     /* calculate hash */
-    uint64_t hash = hash_func_tt(board->hash, table.no_bits);
+    uint64_t hash = hash_func_tt(key, table.no_bits);
 
-    /* get bucket */
-    tt_bucket_t* bucket = &table.buckets[hash];
-    
-    /* get the pointer to the replace_always */
-    tt_entry_t* entry_always_replace = &bucket->always_replace;
-
-    /* fill fields of entry */
-    entry_always_replace->key = board->hash;
-    entry_always_replace->best_move = move;
-    entry_always_replace->depth = depth;
-    entry_always_replace->eval = eval;
-    entry_always_replace->flags = flags;
-
-    /* get the pointer to the replace_if_better */
-    tt_entry_t* entry_if_better = &bucket->replace_if_better;
-
-    if(entry_always_replace->depth > entry_if_better->depth) {
-        /* fill fields of entry */
-        entry_if_better->key = board->hash;
-        entry_if_better->best_move = move;
-        entry_if_better->depth = depth;
-        entry_if_better->eval = eval;
-        entry_if_better->flags = flags;
+    /* get cluster */
+    tt_cluster_t* cluster = &table.clusters[hash];
+
+    /* find the slot to replace: the slot of the same position, an empty slot or otherwise the least worthy slot */
+    tt_slot_t* replace = NULL;
+    int replace_worth = INT_MAX;
+    for(int i = 0; i < TT_CLUSTER_SIZE; i++) {
+        tt_slot_t* slot = &cluster->slots[i];
+        uint64_t stored_key = __atomic_load_n(&slot->key, __ATOMIC_RELAXED);
+        uint64_t stored_data = __atomic_load_n(&slot->data, __ATOMIC_RELAXED);
+
+        /* same position: keep the old entry if it was searched deeper in this search (an exact score is always stored) */
+        if((stored_key ^ stored_data) == key) {
+            if(flags != EXACT && depth < tt_data_depth(stored_data) && tt_data_generation(stored_data) == table.generation) return;
+            replace = slot;
+            break;
+        }
+
+        /* empty slot */
+        if(stored_key == 0ULL && stored_data == 0ULL) {
+            replace = slot;
+            break;
+        }
+
+        int worth = tt_data_worth(table, stored_data);
+        if(worth < replace_worth) {
+            replace = slot;
+            replace_worth = worth;
+        }
     }
+
+    write_tt_slot(replace, key, pack_tt_data(move, depth, eval, flags, table.generation, static_eval));
+}
+
+/* retrieves an entry from transposition table, returns 1 (and fills entry) if found */
+int retrieve_tt_entry(tt_t table, board_t* board, tt_entry_t* entry) {
+    return retrieve_tt_entry_by_key(table, board->hash, entry);
 }
 
-/* retrieves an entry from transposition table */
-tt_entry_t* retrieve_tt_entry(tt_t table, board_t* board) {
-    /* calculate zobrist key and hash */
-    uint64_t key = board->hash;
+/* retrieves the entry stored under the given key, returns 1 (and fills entry) if found */
+int retrieve_tt_entry_by_key(tt_t table, uint64_t key, tt_entry_t* entry) {
+    /* calculate hash */
     uint64_t hash = hash_func_tt(key, table.no_bits);
 
-    /* get bucket */
-    tt_entry_t* entry_always_replace = &table.buckets[hash].always_replace;
-    tt_entry_t* entry_replace_if_better = &table.buckets[hash].replace_if_better;
+    /* get cluster */
+    tt_cluster_t* cluster = &table.clusters[hash];
+    uint64_t data;
 
-    if(entry_replace_if_better->key == key){
-        return entry_replace_if_better;
-    } else if (entry_always_replace->key == key){
-        return entry_always_replace;
+    for(int i = 0; i < TT_CLUSTER_SIZE; i++) {
+        if(read_tt_slot(&cluster->slots[i], key, &data)) {
+            unpack_tt_data(key, data, entry);
+            return 1;
+        }
     }
 
-    return NULL;
+    return 0;
+}
+
+/* prefetches the cluster of the given zobrist key into the cache (a later retrieval then does not stall) */
+void prefetch_tt_entry(tt_t table, uint64_t key) {
+    __builtin_prefetch(&table.clusters[hash_func_tt(key, table.no_bits)]);
 }
 
 /* returns the eval for the board position based on tt entry */
 int tt_eval(tt_t table, board_t* board) {
-    /* calculate zobrist key and hash */
-    uint64_t key = board->hash;
-    uint64_t hash = hash_func_tt(board->hash, table.no_bits);
-
-    /* get entries */
-    tt_entry_t* entry_always_replace = &table.buckets[hash].always_replace;
-    tt_entry_t* entry_replace_if_better = &table.buckets[hash].replace_if_better;
+    tt_entry_t entry;
 
     /* return eval if there exist an entry for the board */
-    if(entry_replace_if_better->key == key){
-        return entry_replace_if_better->eval;
-    } else if (entry_always_replace->key == key){
-        return entry_always_replace->eval;
+    if(retrieve_tt_entry(table, board, &entry)){
+        return entry.eval;
     }
 
     /* otherwise, return worst eval */
@@ -158,22 +386,14 @@ int tt_eval(tt_t table, board_t* board) {
 
 /* Gets the best move for the board position based on tt entry */
 move_t* tt_best_move(tt_t table, board_t *board) {
-    /* calculate zobrist key and hash */
-    uint64_t key = board->hash;
-    uint64_t hash = hash_func_tt(board->hash, table.no_bits);
+    tt_entry_t entry;
 
-    /* get entries */
-    tt_entry_t* entry_always_replace = &table.buckets[hash].always_replace;
-    tt_entry_t* entry_replace_if_better = &table.buckets[hash].replace_if_better;
-
-    /* return eval if there exist an entry for the board */
-    if(entry_replace_if_better->key == key){
-        return copy_move(&entry_replace_if_better->best_move);
-    } else if (entry_always_replace->key == key){
-        return copy_move(&entry_always_replace->best_move);
+    /* return best move if there exist an entry for the board */
+    if(retrieve_tt_entry(table, board, &entry)){
+        return copy_move(&entry.best_move);
     }
     
-    /* otherwise, return worst eval */
+    /* otherwise, return no move */
     return NULL;
 }
 
@@ -195,14 +415,21 @@ void print_tt_entry(tt_entry_t* entry) {
     printf("depth: %d\n", entry->depth);
     printf("eval: %d\n", entry->eval);
     printf("flags: %d\n", entry->flags);
+    printf("static eval: %d\n", entry->static_eval);
 }
 
-/* returns how full the transposition table is in per mille */
+/* returns how full the transposition table is with entries of the current search in per mille */
+/* (estimated from the first clusters only, since scanning a large table would stall the search) */
 int tt_permille_full(tt_t table) {
-    uint64_t count = 0;
-    for (int i = 0; i < table.size; i++) {
-        if (table.buckets[i].always_replace.key != 0ULL) count++;
-        if (table.buckets[i].replace_if_better.key != 0ULL) count++;
+    int sample_size = (table.size < TT_HASHFULL_SAMPLE) ? table.size : TT_HASHFULL_SAMPLE;
+    int count = 0;
+    for (int i = 0; i < sample_size; i++) {
+        for (int j = 0; j < TT_CLUSTER_SIZE; j++) {
+            tt_slot_t* slot = &table.clusters[i].slots[j];
+            uint64_t key = __atomic_load_n(&slot->key, __ATOMIC_RELAXED);
+            uint64_t data = __atomic_load_n(&slot->data, __ATOMIC_RELAXED);
+            if (key != 0ULL && tt_data_generation(data) == table.generation) count++;
+        }
     }
-    return ((int)((count * 1000) / (table.size * 2)));
+    return (count * 1000) / (sample_size * TT_CLUSTER_SIZE);
 }
@@ -10,6 +10,7 @@
 #include "include/engine-core/search.h"
 #include "include/engine-core/board.h"
 #include "include/engine-core/move.h"
+#include "include/engine-core/nnue.h"
 #include "include/engine-core/pq.h"
 #include "include/engine-core/prettyprint.h"
 
@@ -19,7 +20,7 @@
 #define VALID_PROM_FLAG(X) (X != -1)
 
 int verbosity = 0;
-int search_running = 0;
+int search_running = 0;     /* set by the UCI thread before a search starts, cleared by the search thread */
 
 /* ------------------------------------------------------------------------------------------------ */
 /* functions for option and engine info handling                                                    */
@@ -28,9 +29,18 @@ int search_running = 0;
 /* initializes the options */
 options_t init_options(void){
     options_t options = {
-        .opt_hash = {.min = 1, .max = 1024, .def = 256, .cur = 256},
+        .opt_hash = {.min = 1, .max = 65536, .def = 256, .cur = 256},
+        .opt_hash_file = {.def = "", .cur = ""},
+        .opt_eval_file = {.def = "", .cur = ""},
+        .opt_threads = {.min = 1, .max = MAXTHREADS, .def = 1, .cur = 1},
         .opt_local_lag = {.min = 0, .max = 100, .def = 15, .cur = 15},
-        .opt_remote_lag = {.min = 0, .max = 300, .def = 0, .cur = 0} 
+        .opt_remote_lag = {.min = 0, .max = 300, .def = 0, .cur = 0},
+        .opt_lazy_eval_margin = {.min = 0, .max = 10000, .def = LAZY_EVAL_MARGIN, .cur = LAZY_EVAL_MARGIN},
+        .opt_futility_margin = {.min = 0, .max = 1000, .def = FUTILITY_MARGIN, .cur = FUTILITY_MARGIN},
+        .opt_razor_margin = {.min = 0, .max = 2000, .def = RAZOR_MARGIN, .cur = RAZOR_MARGIN},
+        .opt_lmp_base = {.min = 0, .max = 100, .def = LMP_BASE, .cur = LMP_BASE},
+        .opt_probcut_margin = {.min = 0, .max = 2000, .def = PROBCUT_MARGIN, .cur = PROBCUT_MARGIN},
+        .opt_qsearch_checks = {.min = 0, .max = 1, .def = QSEARCH_CHECKS, .cur = QSEARCH_CHECKS}
     };
 
     return options;
@@ -63,6 +73,51 @@ char* to_lower(char* s) {
   return s;
 }
 
+/* parses the 'value <x>' part of a setoption command for a spin option, returns 1 on success */
+int parse_spin_value(spin_value_t* spin){
+    char* value_indicator = strtok(NULL, " \n\t");
+    if(!value_indicator){
+        verbosity_print("value indicator 'value' not given"); 
+        return 0; 
+    }
+
+    char* value_str = strtok(NULL, " \n\t");
+    if(!value_str) { 
+        verbosity_print("no value given"); 
+        return 0; 
+    }
+
+    int value = atoi(value_str);
+
+    /* check if value lies in acceptable range */
+    if(value < spin->min || value > spin->max){
+        verbosity_print("value out of range - use 'uci' for more information "); 
+        return 0;
+    }
+
+    spin->cur = value;
+    return 1;
+}
+
+/* parses the value of a string option (the rest of the line, '<empty>' for an empty string) */
+int parse_string_value(string_value_t* string){
+    char* value_indicator = strtok(NULL, " \n\t");
+    if(!value_indicator){
+        verbosity_print("value indicator 'value' not given"); 
+        return 0; 
+    }
+
+    char* value_str = strtok(NULL, "\n");
+    if(!value_str || !strcmp(value_str, "<empty>")) value_str = "";
+    if(strlen(value_str) >= STRING_VALUE_SIZE) {
+        verbosity_print("value too long");
+        return 0;
+    }
+
+    strcpy(string->cur, value_str);
+    return 1;
+}
+
 
 /* ------------------------------------------------------------------------------------------------ */
 /* functions for managing uci interface                                                             */
@@ -95,12 +150,12 @@ move_t *LAN_to_move(board_t *board, char *move_str) {
     idx_t to = 8 * rank_to + file_to;
 
     /* generate all possible moves in the current position */
-    maxpq_t movelst;
-    initialize_maxpq(&movelst);
+    movelist_t movelst;
+    init_movelist(&movelst);
     generate_moves(board, &movelst);
 
     /* check if the move described by the move string is a valid move, i.e. in the move list */
-    for (int i = 1; i < (&movelst)->nr_elem + 1; i++) {
+    for (int i = 0; i < movelst.nr_elem; i++) {
         move_t* move = &movelst.array[i];
         if (move->from == from && move->to == to){
             /* if move is matches a non-promotion, we are finished */
@@ -123,21 +178,37 @@ move_t *LAN_to_move(board_t *board, char *move_str) {
 }
 
 /* Starts the search intitiated by user/gui */
+/* NOTICE: search_running is set before the thread is created (see start_search_thread), so that
+   no command touching the table or the network slips in before the search has started */
 void *start_search(void *args) {
     searchdata_t *searchdata = (searchdata_t *)args;
 
-    /* indicate that search is running */
-    search_running = 1;
-
     /* start iterative search */
     search(searchdata);
 
     /* inidiacte that search is finished */
-    search_running = 0;
+    __atomic_store_n(&search_running, 0, __ATOMIC_RELEASE);
 
     pthread_exit(NULL);
 }
 
+/* Marks the search as running and starts it in the given thread */
+static void start_search_thread(searchdata_t *searchdata, pthread_t *search_thread) {
+    __atomic_store_n(&search_running, 1, __ATOMIC_RELEASE);
+    pthread_create(search_thread, NULL, start_search, (void *)searchdata);
+}
+
+/* returns 1 if a search is running */
+static int is_search_running(void) {
+    return __atomic_load_n(&search_running, __ATOMIC_ACQUIRE);
+}
+
+/* Waits for the thread of the last search (if any), so that its data can be freed */
+static void join_search_thread(pthread_t *search_thread, int *joinable) {
+    if (*joinable) pthread_join(*search_thread, NULL);
+    *joinable = 0;
+}
+
 /* prints the UCI command response */
 void uci_command_response(uci_args_t* uci_args) {
     /* print engine info */
@@ -148,15 +219,24 @@ void uci_command_response(uci_args_t* uci_args) {
 
     /* print options */
     printf("option name Hash type spin default %d min %d max %d\n", uci_args->options.opt_hash.def, uci_args->options.opt_hash.min, uci_args->options.opt_hash.max);
+    printf("option name HashFile type string default %s\n", (*uci_args->options.opt_hash_file.def) ? uci_args->options.opt_hash_file.def : "<empty>");
+    printf("option name EvalFile type string default %s\n", (*uci_args->options.opt_eval_file.def) ? uci_args->options.opt_eval_file.def : "<empty>");
+    printf("option name Threads type spin default %d min %d max %d\n", uci_args->options.opt_threads.def, uci_args->options.opt_threads.min, uci_args->options.opt_threads.max);
     printf("option name Move Overhead type spin default %d min %d max %d\n", uci_args->options.opt_remote_lag.def, uci_args->options.opt_remote_lag.min, uci_args->options.opt_remote_lag.max);
     printf("option name Move OverheadLocal type spin default %d min %d max %d\n",  uci_args->options.opt_local_lag.def, uci_args->options.opt_local_lag.min, uci_args->options.opt_local_lag.max);
+    printf("option name LazyEvalMargin type spin default %d min %d max %d\n", uci_args->options.opt_lazy_eval_margin.def, uci_args->options.opt_lazy_eval_margin.min, uci_args->options.opt_lazy_eval_margin.max);
+    printf("option name FutilityMargin type spin default %d min %d max %d\n", uci_args->options.opt_futility_margin.def, uci_args->options.opt_futility_margin.min, uci_args->options.opt_futility_margin.max);
+    printf("option name RazorMargin type spin default %d min %d max %d\n", uci_args->options.opt_razor_margin.def, uci_args->options.opt_razor_margin.min, uci_args->options.opt_razor_margin.max);
+    printf("option name LMPBase type spin default %d min %d max %d\n", uci_args->options.opt_lmp_base.def, uci_args->options.opt_lmp_base.min, uci_args->options.opt_lmp_base.max);
+    printf("option name ProbCutMargin type spin default %d min %d max %d\n", uci_args->options.opt_probcut_margin.def, uci_args->options.opt_probcut_margin.min, uci_args->options.opt_probcut_margin.max);
+    printf("option name QSearchChecks type spin default %d min %d max %d\n", uci_args->options.opt_qsearch_checks.def, uci_args->options.opt_qsearch_checks.min, uci_args->options.opt_qsearch_checks.max);
 
     /* print uciok to indicate that engine is ready */
     printf("uciok\n");
 }
 
 /* handles and prints the setoption command response */
-void setoption_command_response(options_t* options){
+void setoption_command_response(options_t* options, tt_t* tt){
     char* option_indicator = strtok(NULL, " \n\t");
     if(!option_indicator) { 
         verbosity_print("option name indicator 'name' not given"); 
@@ -197,9 +277,80 @@ void setoption_command_response(options_t* options){
 
         /* restrict hash table size */
         options->opt_hash.cur = value;
+        resize_tt(tt, MB_TO_BYTES(value));
         verbosity_print("hashtable size has been set acorrdingly");
 
     }
+    /* HASHFILE option */
+    else if (!strcmp(option, "hashfile")){
+        if(parse_string_value(&options->opt_hash_file)){
+            /* the table is written back to its old file (if any), then the new file is loaded */
+            /* NOTICE: only safe since options are set once the search thread has been joined (see uci_interface_loop) */
+            free_tt(*tt);
+            if(*options->opt_hash_file.cur){
+                *tt = init_tt_file(options->opt_hash_file.cur, MB_TO_BYTES(options->opt_hash.cur));
+            } else {
+                *tt = init_tt(MB_TO_BYTES(options->opt_hash.cur));
+            }
+            verbosity_print("hashtable file has been set accordingly");
+        }
+    }
+    /* EVALFILE option */
+    else if (!strcmp(option, "evalfile")){
+        if(parse_string_value(&options->opt_eval_file)){
+            /* without a network file the PeSTO evaluation is used */
+            if(!*options->opt_eval_file.cur){
+                unload_nnue();
+                verbosity_print("network has been unloaded");
+            } else if(load_nnue(options->opt_eval_file.cur)){
+                verbosity_print("network has been loaded");
+            }
+            /* the table holds static evaluations of the previous evaluation function */
+            reset_tt(*tt);
+        }
+    }
+    /* LAZYEVALMARGIN option */
+    else if (!strcmp(option, "lazyevalmargin")){
+        if(parse_spin_value(&options->opt_lazy_eval_margin)){
+            verbosity_print("lazy evaluation margin has been set accordingly");
+        }
+    }
+    /* FUTILITYMARGIN option */
+    else if (!strcmp(option, "futilitymargin")){
+        if(parse_spin_value(&options->opt_futility_margin)){
+            verbosity_print("futility margin has been set accordingly");
+        }
+    }
+    /* RAZORMARGIN option */
+    else if (!strcmp(option, "razormargin")){
+        if(parse_spin_value(&options->opt_razor_margin)){
+            verbosity_print("razor margin has been set accordingly");
+        }
+    }
+    /* LMPBASE option */
+    else if (!strcmp(option, "lmpbase")){
+        if(parse_spin_value(&options->opt_lmp_base)){
+            verbosity_print("late move pruning base has been set accordingly");
+        }
+    }
+    /* PROBCUTMARGIN option */
+    else if (!strcmp(option, "probcutmargin")){
+        if(parse_spin_value(&options->opt_probcut_margin)){
+            verbosity_print("probcut margin has been set accordingly");
+        }
+    }
+    /* QSEARCHCHECKS option */
+    else if (!strcmp(option, "qsearchchecks")){
+        if(parse_spin_value(&options->opt_qsearch_checks)){
+            verbosity_print("quiet checks in quiescence search have been set accordingly");
+        }
+    }
+    /* THREADS option */
+    else if (!strcmp(option, "threads")){
+        if(parse_spin_value(&options->opt_threads)){
+            verbosity_print("number of search threads has been set accordingly");
+        }
+    }
     /* MOVE OVERHEAD/OVERHEADLOCAL option */ 
     else if (!strcmp(option, "move")){
         char* option_part_two = strtok(NULL, " \n\t");
@@ -267,8 +418,10 @@ void setoption_command_response(options_t* options){
 }
 
 /* handles and prints the ucinewgame command response */
-void ucinewgame_command_response(board_t* board){
+void ucinewgame_command_response(board_t* board, tt_t tt){
     clear_board(board);
+    /* entries of the previous game are of no use anymore */
+    reset_tt(tt);
     verbosity_print("new game started");
 }
 
@@ -365,7 +518,7 @@ int go_command_response(searchdata_t* searchdata, pthread_t* search_thread){
     /* if no specification given, search infinite */
     if(!token) { 
         verbosity_print("no specification given - searching infinite");
-        pthread_create(search_thread, NULL, start_search, (void *)searchdata);
+        start_search_thread(searchdata, search_thread);
         return 0; 
     }
 
@@ -466,7 +619,7 @@ int go_command_response(searchdata_t* searchdata, pthread_t* search_thread){
     }
 
     verbosity_print("searching ...");
-    pthread_create(search_thread, NULL, start_search, (void *)searchdata);
+    start_search_thread(searchdata, search_thread);
     return 0; 
 }
 
@@ -482,7 +635,7 @@ void uci_interface_loop(void *args) {
     /* verbosity level set by -v command line flag */
     verbosity = uci_args->verbosity_level;
     /* set search running to false */
-    search_running = 0;
+    __atomic_store_n(&search_running, 0, __ATOMIC_RELEASE);
 
     /* remove buffering from stdin and stdout */
     setbuf(stdin, NULL);
@@ -491,8 +644,12 @@ void uci_interface_loop(void *args) {
     /* print (reduced) chess engine info at startup */
     printf("%s %s by %s\n", engine_info.name, engine_info.version, engine_info.author);
 
-    /* initialize search thread */
-    pthread_t search_thread = NULL;
+    /* initialize search thread (joinable once a search has been started) */
+    pthread_t search_thread;
+    int search_thread_joinable = 0;
+
+    /* initialize transposition table (kept across searches, so later searches can use earlier results) */
+    tt_t tt = init_tt(MB_TO_BYTES(options->opt_hash.cur));
 
     /* start the main loop */
     while(1){
@@ -529,21 +686,35 @@ void uci_interface_loop(void *args) {
             uci_command_response(uci_args);
         } else if (!strcmp(command, "isready")) {
             printf("readyok\n");
-        } else if (!strcmp(command, "setoption") && !search_running){
-            setoption_command_response(options);
-        } else if (!strcmp(command, "ucinewgame")){
-            ucinewgame_command_response(board);
-        } else if(!strcmp(command, "position") && !search_running){
+        } else if (!strcmp(command, "setoption") && !is_search_running()){
+            /* options may replace the table (Hash, HashFile) or the network, so the last search has to be done with them */
+            join_search_thread(&search_thread, &search_thread_joinable);
+            setoption_command_response(options, &tt);
+        } else if (!strcmp(command, "ucinewgame") && !is_search_running()){
+            /* the table is cleared, so the last search has to be done with it */
+            join_search_thread(&search_thread, &search_thread_joinable);
+            ucinewgame_command_response(board, tt);
+        } else if(!strcmp(command, "position") && !is_search_running()){
             position_command_response(board);
-        } else if(!strcmp(command, "go") && !search_running){
+        } else if(!strcmp(command, "go") && !is_search_running()){
+            /* the last search has finished, but its thread may still hold its data */
+            join_search_thread(&search_thread, &search_thread_joinable);
             if(searchdata) free_search_data(searchdata);
+            age_tt(&tt);
             searchdata = init_search_data(board,
-                                          options->opt_hash.cur, 
+                                          tt, 
+                                          options->opt_threads.cur,
                                           options->opt_local_lag.cur, 
                                           options->opt_remote_lag.cur);
-            go_command_response(searchdata, &search_thread);
+            searchdata->lazy_eval_margin = options->opt_lazy_eval_margin.cur;
+            searchdata->futility_margin = options->opt_futility_margin.cur;
+            searchdata->razor_margin = options->opt_razor_margin.cur;
+            searchdata->lmp_base = options->opt_lmp_base.cur;
+            searchdata->probcut_margin = options->opt_probcut_margin.cur;
+            searchdata->qsearch_checks = options->opt_qsearch_checks.cur;
+            search_thread_joinable = !go_command_response(searchdata, &search_thread);
         } else if (!strcmp(command, "stop")) {
-            if(searchdata) searchdata->timer.stop = 1;
+            if(searchdata) stop_search(&searchdata->timer);
         } 
         else if(!strcmp(command, "quit")){
             break;
@@ -552,5 +723,13 @@ void uci_interface_loop(void *args) {
         } 
     }
 
+    /* wait for a running search before freeing the table (a file-backed table is written back) */
+    if(searchdata){
+        stop_search(&searchdata->timer);
+        join_search_thread(&search_thread, &search_thread_joinable);
+        free_search_data(searchdata);
+    }
+    free_tt(tt);
+
     return;
 }
@@ -6,18 +6,29 @@
 
 zobrist_t zobrist_table;
 
+/* pseudorandom number generator (splitmix64), independent of rand() so that the keys only depend on the seed */
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
 /* Initializes the global zobrist table */
 void initialize_zobrist_table(void) {
+    zobrist_table.seed = ZOBRIST_SEED;
+    uint64_t state = ZOBRIST_SEED;
+
     /* Initialize random 64 bit number for each piece on each square of the
      * board */
     for (int i = 0; i < 64; i++) {
         for (int piece = 0; piece < 14; piece++) {
-            zobrist_table.piece_random64[piece][i] = random_uint64();
+            zobrist_table.piece_random64[piece][i] = splitmix64(&state);
         }
     }
     /* Initialize random 64 bit number for every board flag */
     for (int i = 0; i < 26; i++) {
-        zobrist_table.flag_random64[i] = random_uint64();
+        zobrist_table.flag_random64[i] = splitmix64(&state);
     }
 }
 
@@ -99,3 +110,29 @@ uint64_t calculate_zobrist_hash(board_t *board) {
     }
     return hash;
 }
+
+/* Hashes the pawns of a board using zobrist hashing */
+/* NOTICE: the pawn hash of a board without pawns is 0 */
+uint64_t calculate_pawn_hash(board_t *board) {
+    uint64_t hash = 0ULL;
+
+    bitboard_t pawns = board->piece_bb[B_PAWN];
+    while (pawns) {
+        hash ^= zobrist_table.piece_random64[B_PAWN][pop_1st_bit(&pawns)];
+    }
+    pawns = board->piece_bb[W_PAWN];
+    while (pawns) {
+        hash ^= zobrist_table.piece_random64[W_PAWN][pop_1st_bit(&pawns)];
+    }
+    return hash;
+}
+
+/* Hashes a position searched without the given move (e.g. by the singular extension search) */
+/* NOTICE: the random numbers of the (unused) pieces 6 and 7 are used, so the key differs from */
+/* the keys of all positions. The flags rotate the key of the target square (promotions) */
+uint64_t excluded_move_hash(uint64_t hash, move_t move) {
+    uint64_t to_key = zobrist_table.piece_random64[7][move.to];
+    int rotation = move.flags & 63;
+    to_key = (to_key << rotation) | (to_key >> ((64 - rotation) & 63));
+    return hash ^ zobrist_table.piece_random64[6][move.from] ^ to_key;
+}
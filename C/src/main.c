@@ -1,9 +1,11 @@
 #include <unistd.h>
+#include <string.h>
 
 #include "include/engine-core/init.h"
 #include "include/engine-core/types.h"
 #include "include/engine-core/board.h"
 #include "include/engine-core/uci.h"
+#include "include/engine-core/nnue.h"
 
 
 #include <stdio.h>
@@ -12,14 +14,18 @@
 int main(int argc, char *argv[]) {
     /* variables set by command line options */
     int verbose = 0;
+    char* eval_file = NULL;
 
     /* command line parsing using getopt */
     int opt;
-    while ((opt = getopt(argc, argv, "v")) != -1) {
+    while ((opt = getopt(argc, argv, "ve:")) != -1) {
         switch (opt) {
             case 'v':
                 verbose = 1;
                 break;
+            case 'e':
+                eval_file = optarg;
+                break;
             default:
                 fprintf(stderr, "Unknown option: %c\n", opt);
                 exit(-1);
@@ -30,6 +36,7 @@ int main(int argc, char *argv[]) {
     fprintf(stderr, "\033[0;35m");
     fprintf(stderr, "Settings:\n");
     fprintf(stderr, " Verbosity level: %s\n", (verbose) ? "high" : "low");
+    fprintf(stderr, " Evaluation: %s\n", (eval_file) ? eval_file : "PeSTO");
     fprintf(stderr, "\033[0m\n");
 
     /* initialize uci arguments */
@@ -46,6 +53,12 @@ int main(int argc, char *argv[]) {
     initialize_helper_boards();
     initialize_zobrist_table();
     initialize_eval_tables();
+    initialize_search_tables();
+
+    /* load the network (the board has to be set up again afterwards, which the uci interface does anyway) */
+    if (eval_file && load_nnue(eval_file) && strlen(eval_file) < STRING_VALUE_SIZE) {
+        strcpy(args.options.opt_eval_file.cur, eval_file);
+    }
 
     /* start uci interface of chess engine */
     uci_interface_loop(&args);
@@ -94,8 +94,8 @@ move_set_array_t* games_to_move_sets(chess_games_t chess_games) {
             move_t* move = str_to_move(board, token);
             if (move) {
                 /* generate all possible moves */
-                maxpq_t move_lst;
-                initialize_maxpq(&move_lst);
+                movelist_t move_lst;
+                init_movelist(&move_lst);
                 generate_moves(board, &move_lst);
 
                 /* create array to hold all move keys corresponding to possible moves */
@@ -108,8 +108,8 @@ move_set_array_t* games_to_move_sets(chess_games_t chess_games) {
 
                 /* extract move key from all other moves */
                 move_t other_move;
-                while (!is_empty(&move_lst)) {
-                    other_move = pop_max(&move_lst);
+                while (has_next(&move_lst)) {
+                    other_move = pick_next(&move_lst);
                     /* if we see move made, skip it */
                     if (is_same_move(*move, other_move)) {
                         continue;
@@ -26,16 +26,16 @@ idx_t str_to_idx(char file, char rank) {
 move_t* find_pawn_move(board_t* board, char file1, char file2, char rank2,
                        int promotion, char promo_piece) {
     /* generate all possible moves in the current position */
-    maxpq_t move_lst;
-    initialize_maxpq(&move_lst);
+    movelist_t move_lst;
+    init_movelist(&move_lst);
     generate_moves(board, &move_lst);
 
     /* determine index of to square */
     idx_t to = str_to_idx(file2, rank2);
 
     /* iterate through all moves */
-    for (int i = 1; i < (&move_lst)->nr_elem + 1; i++) {
-        move_t* move = &(&move_lst)->array[i];
+    for (int i = 0; i < move_lst.nr_elem; i++) {
+        move_t* move = &move_lst.array[i];
 
         /* check if move is a pawn move */
         bitboard_t from_mask = 1ULL << move->from;
@@ -87,13 +87,13 @@ move_t* find_pawn_move(board_t* board, char file1, char file2, char rank2,
 /* determines castle move equal to the move described by flags */
 move_t* find_castle_move(board_t* board, int kingside) {
     /* generate all possible moves in the current position */
-    maxpq_t move_lst;
-    initialize_maxpq(&move_lst);
+    movelist_t move_lst;
+    init_movelist(&move_lst);
     generate_moves(board, &move_lst);
 
     /* iterate through all moves */
-    for (int i = 1; i < (&move_lst)->nr_elem + 1; i++) {
-        move_t* move = &(&move_lst)->array[i];
+    for (int i = 0; i < move_lst.nr_elem; i++) {
+        move_t* move = &move_lst.array[i];
         /* if kingside castle found */
         if (kingside && move->flags == KCASTLE) {
             move_t* copy = copy_move(move);
@@ -116,15 +116,15 @@ move_t* find_knight_move(board_t* board, char file1, char rank1, char file2,
                          char rank2, int single_ambiguous,
                          int double_ambiguous) {
     /* generate all possible moves in the current position */
-    maxpq_t move_lst;
-    initialize_maxpq(&move_lst);
+    movelist_t move_lst;
+    init_movelist(&move_lst);
     generate_moves(board, &move_lst);
 
     /* determine index of to square */
     idx_t to = str_to_idx(file2, rank2);
     /* iterate through all moves */
-    for (int i = 1; i < (&move_lst)->nr_elem + 1; i++) {
-        move_t* move = &(&move_lst)->array[i];
+    for (int i = 0; i < move_lst.nr_elem; i++) {
+        move_t* move = &move_lst.array[i];
 
         /* check if move is a knight move */
         bitboard_t from_mask = 1ULL << move->from;
@@ -170,16 +170,16 @@ move_t* find_bishop_move(board_t* board, char file1, char rank1, char file2,
                          char rank2, int single_ambiguous,
                          int double_ambiguous) {
     /* generate all possible moves in the current position */
-    maxpq_t move_lst;
-    initialize_maxpq(&move_lst);
+    movelist_t move_lst;
+    init_movelist(&move_lst);
     generate_moves(board, &move_lst);
 
     /* determine index of to square */
     idx_t to = str_to_idx(file2, rank2);
 
     /* iterate through all moves */
-    for (int i = 1; i < (&move_lst)->nr_elem + 1; i++) {
-        move_t* move = &(&move_lst)->array[i];
+    for (int i = 0; i < move_lst.nr_elem; i++) {
+        move_t* move = &move_lst.array[i];
 
         /* check if move is a bishop move */
         bitboard_t from_mask = 1ULL << move->from;
@@ -224,16 +224,16 @@ move_t* find_bishop_move(board_t* board, char file1, char rank1, char file2,
 move_t* find_rook_move(board_t* board, char file1, char rank1, char file2,
                        char rank2, int single_ambiguous, int double_ambiguous) {
     /* generate all possible moves in the current position */
-    maxpq_t move_lst;
-    initialize_maxpq(&move_lst);
+    movelist_t move_lst;
+    init_movelist(&move_lst);
     generate_moves(board, &move_lst);
 
     /* determine index of to square */
     idx_t to = str_to_idx(file2, rank2);
 
     /* iterate through all moves */
-    for (int i = 1; i < (&move_lst)->nr_elem + 1; i++) {
-        move_t* move = &(&move_lst)->array[i];
+    for (int i = 0; i < move_lst.nr_elem; i++) {
+        move_t* move = &move_lst.array[i];
 
         /* check if move is a rook move */
         bitboard_t from_mask = 1ULL << move->from;
@@ -279,16 +279,16 @@ move_t* find_queen_move(board_t* board, char file1, char rank1, char file2,
                         char rank2, int single_ambiguous,
                         int double_ambiguous) {
     /* generate all possible moves in the current position */
-    maxpq_t move_lst;
-    initialize_maxpq(&move_lst);
+    movelist_t move_lst;
+    init_movelist(&move_lst);
     generate_moves(board, &move_lst);
 
     /* determine index of to square */
     idx_t to = str_to_idx(file2, rank2);
 
     /* iterate through all moves */
-    for (int i = 1; i < (&move_lst)->nr_elem + 1; i++) {
-        move_t* move = &(&move_lst)->array[i];
+    for (int i = 0; i < move_lst.nr_elem; i++) {
+        move_t* move = &move_lst.array[i];
 
         /* check if move is a queen move */
         bitboard_t from_mask = 1ULL << move->from;
@@ -333,16 +333,16 @@ move_t* find_queen_move(board_t* board, char file1, char rank1, char file2,
 move_t* find_king_move(board_t* board, char file1, char rank1, char file2,
                        char rank2, int single_ambiguous, int double_ambiguous) {
     /* generate all possible moves in the current position */
-    maxpq_t move_lst;
-    initialize_maxpq(&move_lst);
+    movelist_t move_lst;
+    init_movelist(&move_lst);
     generate_moves(board, &move_lst);
 
     /* determine index of to square */
     idx_t to = str_to_idx(file2, rank2);
 
     /* iterate through all moves */
-    for (int i = 1; i < (&move_lst)->nr_elem + 1; i++) {
-        move_t* move = &(&move_lst)->array[i];
+    for (int i = 0; i < move_lst.nr_elem; i++) {
+        move_t* move = &move_lst.array[i];
 
         /* check if move is a king move */
         bitboard_t from_mask = 1ULL << move->from;
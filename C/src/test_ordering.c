@@ -39,8 +39,8 @@ double test_model(chess_game_t** chess_games, int no_games, int id) {
             move_t* move = str_to_move(board, token);
             if (move) {
                 /* generate all possible moves */
-                maxpq_t move_lst;
-                initialize_maxpq(&move_lst);
+                movelist_t move_lst;
+                init_movelist(&move_lst);
                 generate_moves(board, &move_lst);
 
                 /* create arrays to hold move hashes and indices of moves as in move list */
@@ -56,8 +56,8 @@ double test_model(chess_game_t** chess_games, int no_games, int id) {
 
                 /* calculate move hashes for OTHER_MOVES */
                 move_t other_move;
-                while (!is_empty(&move_lst)) {
-                    other_move = pop_max(&move_lst);
+                while (has_next(&move_lst)) {
+                    other_move = pick_next(&move_lst);
                     /* if we see MADE_MOVE, skip it */
                     if (is_same_move(*move, other_move)) {
                         continue;
@@ -100,12 +100,12 @@ double test_model(chess_game_t** chess_games, int no_games, int id) {
                 }
 
                 /* find position of MADE_MOVE in legal move list */
-                maxpq_t legals;
-                initialize_maxpq(&legals);
+                movelist_t legals;
+                init_movelist(&legals);
                 generate_moves(board, &legals);
                 int idx_of_made_move_in_legal_moves = 0;
-                while (!is_empty(&legals)) {
-                    other_move = pop_max(&legals);
+                while (has_next(&legals)) {
+                    other_move = pick_next(&legals);
                     if (is_same_move(*move, other_move)) {
                         break;
                     }
@@ -17,19 +17,102 @@ char TEST5_FEN[] = "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8";
 char TEST6_FEN[] =
     "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10";
 char TEST7_FEN[] = "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1";
+char MATE_IN_2_FEN[] = "kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1";
+
+int errors = 0;
+pawntable_t pawn_table;
+
+/* checks the incrementally updated evaluation state (and pawn hash) against a full recompute and the cached
+   evaluation against the uncached one on every node up to the given depth */
+void check_incremental_eval(board_t* board, int depth) {
+    board_t recomputed = *board;
+    calculate_eval_state(&recomputed);
+    if (recomputed.mg[WHITE] != board->mg[WHITE] || recomputed.mg[BLACK] != board->mg[BLACK] ||
+        recomputed.eg[WHITE] != board->eg[WHITE] || recomputed.eg[BLACK] != board->eg[BLACK] ||
+        recomputed.phase != board->phase || calculate_pawn_hash(board) != board->pawn_hash ||
+        eval_board(board, &pawn_table) != eval_board(board, NULL)) {
+        if (errors++ < 10) print_board(board);
+    }
+    if (depth == 0) return;
+
+    movelist_t movelst;
+    init_movelist(&movelst);
+    generate_moves(board, &movelst);
+    for (int i = 0; i < movelst.nr_elem; i++) {
+        do_move(board, movelst.array[i]);
+        check_incremental_eval(board, depth - 1);
+        undo_move(board, movelst.array[i]);
+    }
+
+    /* null moves leave the evaluation state untouched */
+    if (!is_in_check(board)) {
+        do_null_move(board);
+        check_incremental_eval(board, 0);
+        undo_null_move(board);
+    }
+}
 
 ////////////////////////////////////////////////////////////////
 // MAIN ENTRY POINT
 int main(void) {
-    board_t* board = init_board();
-    load_by_FEN(board, TEST7_FEN);
-
     initialize_attack_boards();
     initialize_helper_boards();
     initialize_zobrist_table();
     initialize_eval_tables();
+    initialize_search_tables();
+
+    /* positions with castling, en passant, (capture) promotions and early promotions */
+    char* fens[] = {STARTING_FEN, TEST2_FEN, TEST3_FEN, TEST4_FEN, TEST5_FEN, TEST6_FEN, TEST7_FEN};
+    pawn_table = init_pawn_table();
+    board_t* board = init_board();
+    for (int i = 0; i < (int) (sizeof(fens) / sizeof(fens[0])); i++) {
+        load_by_FEN(board, fens[i]);
+        check_incremental_eval(board, 3);
+    }
+    if (errors != 0) {
+        printf("%d errors found in incremental evaluation\n", errors);
+        exit(EXIT_FAILURE);
+    }
+    printf("pawn hash hit rate %.2f%% (%llu probes)\n", 100.0 * pawn_table.hits / pawn_table.probes,
+           (unsigned long long) pawn_table.probes);
+    free_pawn_table(&pawn_table);
+
+    /* the evaluation cache returns what was stored for a position, but nothing for other positions */
+    evalcache_t eval_cache = init_eval_cache();
+    int cached_eval = 0;
+    load_by_FEN(board, TEST6_FEN);
+    store_eval_cache(&eval_cache, board, eval_board(board, NULL));
+    if (!probe_eval_cache(&eval_cache, board, &cached_eval) || cached_eval != eval_board(board, NULL)) {
+        printf("evaluation cache does not return the stored evaluation\n");
+        exit(EXIT_FAILURE);
+    }
+    board->hash ^= 1ULL << 32;
+    if (probe_eval_cache(&eval_cache, board, &cached_eval)) {
+        printf("evaluation cache returns the evaluation of a different position\n");
+        exit(EXIT_FAILURE);
+    }
+    free_eval_cache(&eval_cache);
+
+    /* mate scores count the plies to the mate, also when they are read back from the table at other plies */
+    tt_t mate_tt = init_tt(MB_TO_BYTES(16));
+    load_by_FEN(board, MATE_IN_2_FEN);
+    for (int i = 0; i < 2; i++) {
+        searchdata_t* mate_data = init_search_data(board, mate_tt, 1, 15, 0);
+        mate_data->timer.max_depth = 12;
+        mate_data->timer.run_infinite = 1;
+        search(mate_data);
+        if (mate_data->best_eval != INF - 3) {
+            printf("mate in 2 scored %d instead of %d (search %d)\n", mate_data->best_eval, INF - 3, i + 1);
+            exit(EXIT_FAILURE);
+        }
+        free_search_data(mate_data);
+    }
+    free_tt(mate_tt);
+
+    load_by_FEN(board, TEST7_FEN);
 
-    searchdata_t* search_data = init_search_data(board, 256, 15, 0);
+    tt_t tt = init_tt(MB_TO_BYTES(256));
+    searchdata_t* search_data = init_search_data(board, tt, 1, 15, 0);
 
     clock_t end;
     clock_t begin;
@@ -51,8 +134,9 @@ int main(void) {
     end = clock();
     printf("\nTime: \t\t%fs\n", (double)(end - begin) / CLOCKS_PER_SEC);
 
-    free(board);
+    free_board(board);
     free_search_data(search_data);
+    free_tt(tt);
 
     return 0;
 }
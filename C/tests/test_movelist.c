@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <sys/time.h>
+
+#include "include/engine-core/engine.h"
+
+#define BENCH_ITERATIONS 50000
+
+int errors = 0;
+
+/* positions with few and many moves, captures and promotions */
+char* fens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+    "R6R/3Q4/1Q4Q1/4Q3/2Q4Q/Q4Q2/pp1Q4/kBNN1KB1 w - - 0 1",
+};
+
+/* returns the time passed since start in ms */
+double ms_since(struct timeval start) {
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec - start.tv_sec) * 1000.0 + (now.tv_usec - start.tv_usec) / 1000.0;
+}
+
+/* checks that picking hands out every move exactly once and in order of decreasing value */
+void check_pick_order(movelist_t *generated) {
+    movelist_t lst = *generated;
+    int seen[MOVELIST_SIZE] = {0};
+    int last_value = 1 << 16;
+
+    for (int n = 0; n < generated->nr_elem; n++) {
+        if (!has_next(&lst)) {
+            errors++;
+            return;
+        }
+        move_t move = pick_next(&lst);
+        if (move.value > last_value) errors++;
+        last_value = move.value;
+
+        int found = 0;
+        for (int i = 0; i < generated->nr_elem; i++) {
+            if (!seen[i] && is_same_move(move, generated->array[i])) {
+                seen[i] = found = 1;
+                break;
+            }
+        }
+        if (!found) errors++;
+    }
+    if (has_next(&lst)) errors++;
+}
+
+/* fills a list with the given moves and picks the best `picks` of them, returns a checksum */
+/* NOTICE: the empty asm statement keeps the compiler from hoisting the calls out of the benchmark loop */
+__attribute__((noinline)) uint64_t bench_movelist(move_t *moves, int nr_moves, int picks) {
+    __asm__ volatile("" ::: "memory");
+    movelist_t lst;
+    init_movelist(&lst);
+    for (int i = 0; i < nr_moves; i++) add_move(&lst, moves[i]);
+
+    uint64_t checksum = 0;
+    for (int i = 0; i < picks && has_next(&lst); i++) checksum += pick_next(&lst).value;
+    return checksum;
+}
+
+/* fills a heap with the given moves and pops the best `picks` of them, returns a checksum */
+__attribute__((noinline)) uint64_t bench_maxpq(move_t *moves, int nr_moves, int picks) {
+    __asm__ volatile("" ::: "memory");
+    maxpq_t pq;
+    initialize_maxpq(&pq);
+    for (int i = 0; i < nr_moves; i++) insert(&pq, moves[i]);
+
+    uint64_t checksum = 0;
+    for (int i = 0; i < picks && !is_empty(&pq); i++) checksum += pop_max(&pq).value;
+    return checksum;
+}
+
+int main(void) {
+    /* initialize boards for movegen */
+    initialize_attack_boards();
+    initialize_helper_boards();
+
+    /* initialize zobrist table */
+    initialize_zobrist_table();
+
+    int nr_fens = (int) (sizeof(fens) / sizeof(fens[0]));
+    movelist_t generated[nr_fens];
+
+    board_t* board = init_board();
+    for (int i = 0; i < nr_fens; i++) {
+        load_by_FEN(board, fens[i]);
+        init_movelist(&generated[i]);
+        generate_moves(board, &generated[i]);
+        check_pick_order(&generated[i]);
+    }
+    free_board(board);
+
+    if (errors != 0) {
+        printf("%d errors found\n", errors);
+        exit(EXIT_FAILURE);
+    }
+
+    /* microbenchmark: (1) the node cuts off after the first move, (2) after a few moves, (3) all moves are searched */
+    int picks[] = {1, 3, MOVELIST_SIZE};
+    for (int p = 0; p < 3; p++) {
+        uint64_t checksum_lst = 0, checksum_pq = 0;
+
+        struct timeval start;
+        gettimeofday(&start, 0);
+        for (int it = 0; it < BENCH_ITERATIONS; it++) {
+            for (int i = 0; i < nr_fens; i++) checksum_lst += bench_movelist(generated[i].array, generated[i].nr_elem, picks[p]);
+        }
+        double ms_lst = ms_since(start);
+
+        gettimeofday(&start, 0);
+        for (int it = 0; it < BENCH_ITERATIONS; it++) {
+            for (int i = 0; i < nr_fens; i++) checksum_pq += bench_maxpq(generated[i].array, generated[i].nr_elem, picks[p]);
+        }
+        double ms_pq = ms_since(start);
+
+        if (checksum_lst != checksum_pq) {
+            printf("move list and heap disagree on the best moves\n");
+            exit(EXIT_FAILURE);
+        }
+        printf("%3d picks: move list %7.1fms, heap %7.1fms (%.1fx)\n", picks[p], ms_lst, ms_pq, ms_pq / ms_lst);
+    }
+
+    printf("move list tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "include/engine-core/engine.h"
+
+int errors = 0;
+
+/* quiet moves of the previously visited node, used as killer candidates for the next node */
+move_t previous_quiets[MOVELIST_SIZE];
+int nr_previous_quiets = 0;
+
+/* history table with arbitrary scores */
+history_t history;
+
+/* returns a unique key for a move (ignoring its value) */
+int move_key(move_t move) {
+    return (move.from << 10) | (move.to << 4) | move.flags;
+}
+
+/* copies the keys of the moves in a move list into an array, returns the number of moves */
+int copy_keys(movelist_t *movelst, int *keys) {
+    for (int i = 0; i < movelst->nr_elem; i++) keys[i] = move_key(movelst->array[i]);
+    return movelst->nr_elem;
+}
+
+/* returns the index of key in keys, or -1 */
+int find_key(int *keys, int n, int key) {
+    for (int i = 0; i < n; i++) {
+        if (keys[i] == key) return i;
+    }
+    return -1;
+}
+
+/* reports an error for the given board */
+void report(board_t *board, const char *msg) {
+    if (errors++ < 10) {
+        printf("%s\n", msg);
+        print_board(board);
+    }
+}
+
+/* checks the move generators and the move picker against the full move generator on every node up to the given depth */
+void check_node(board_t *board, int depth) {
+    movelist_t movelst;
+    int all[MOVELIST_SIZE], tactical[MOVELIST_SIZE], quiet[MOVELIST_SIZE], picked[MOVELIST_SIZE];
+
+    init_movelist(&movelst);
+    generate_moves(board, &movelst);
+    move_t moves[MOVELIST_SIZE];
+    int nr_all = 0;
+    while (has_next(&movelst)) {
+        moves[nr_all] = pick_next(&movelst);
+        all[nr_all] = move_key(moves[nr_all]);
+        nr_all++;
+    }
+
+    /* (1) tactical and quiet moves partition all legal moves */
+    init_movelist(&movelst);
+    generate_tactical_moves(board, &movelst);
+    int nr_tactical = copy_keys(&movelst, tactical);
+    init_movelist(&movelst);
+    generate_quiet_moves(board, &movelst);
+    int nr_quiet = copy_keys(&movelst, quiet);
+
+    if (nr_tactical + nr_quiet != nr_all) report(board, "tactical and quiet moves do not add up to all moves");
+    for (int i = 0; i < nr_tactical; i++) {
+        if (find_key(all, nr_all, tactical[i]) == -1) report(board, "illegal tactical move");
+        if (find_key(quiet, nr_quiet, tactical[i]) != -1) report(board, "move is tactical and quiet");
+    }
+    for (int i = 0; i < nr_quiet; i++) {
+        if (find_key(all, nr_all, quiet[i]) == -1) report(board, "illegal quiet move");
+    }
+
+    /* (2) in check, the evasions are all legal moves, otherwise the quiet checks are the quiet moves (but castling)
+       giving check */
+    int in_check = is_in_check(board);
+    int special[MOVELIST_SIZE];
+    init_movelist(&movelst);
+    if (in_check) {
+        generate_evasions(board, &movelst);
+    } else {
+        generate_quiet_checks(board, &movelst);
+    }
+    int nr_special = copy_keys(&movelst, special);
+    int nr_expected = in_check ? nr_all : 0;
+    for (int i = 0; !in_check && i < nr_quiet; i++) {
+        move_t m = {0, quiet[i] >> 10, (quiet[i] >> 4) & 63, quiet[i] & 15};
+        if (m.flags == KCASTLE || m.flags == QCASTLE) continue;
+        do_move(board, m);
+        int gives_check = is_in_check(board);
+        undo_move(board, m);
+        nr_expected += gives_check;
+        if (gives_check != (find_key(special, nr_special, quiet[i]) != -1)) report(board, "quiet check missed or not giving check");
+    }
+    for (int i = 0; in_check && i < nr_special; i++) {
+        if (find_key(all, nr_all, special[i]) == -1) report(board, "illegal evasion");
+    }
+    if (nr_special != nr_expected) report(board, in_check ? "evasions do not add up to all moves" : "too many quiet checks");
+
+    /* the remaining checks rely on the pins and checkers of the full generator */
+    init_movelist(&movelst);
+    generate_quiet_moves(board, &movelst);
+
+    /* (3) the legality check of quiet moves agrees with the generator (the generator ran last) */
+    for (int i = 0; i < nr_previous_quiets; i++) {
+        move_t m = previous_quiets[i];
+        if (m.flags != QUIET && m.flags != DOUBLEP) continue;
+        if (is_legal_quiet_move(board, m) != (find_key(quiet, nr_quiet, move_key(m)) != -1)) {
+            report(board, "legality check of quiet move disagrees with move generator");
+        }
+    }
+
+    /* (4) the move picker hands out every legal move exactly once, whatever tt move, killers and counter move it is given,
+       even if the children are searched in between */
+    for (int variant = 0; variant < 3; variant++) {
+        move_t *tt_move = (variant == 0 || nr_all == 0) ? NULL : &moves[(variant * 7) % nr_all];
+        move_t killers[NR_KILLERS] = {{0, 0, 0, 0}, {0, 0, 0, 0}};
+        for (int i = 0; i < NR_KILLERS && i < nr_previous_quiets; i++) {
+            killers[i] = previous_quiets[(variant + i * 5) % nr_previous_quiets];
+        }
+
+        move_t *counter_move = (nr_previous_quiets > 0) ? &previous_quiets[(variant * 3) % nr_previous_quiets] : NULL;
+
+        movepicker_t picker;
+        init_movepicker(&picker, board, tt_move, killers, counter_move, variant == 2 ? &history : NULL);
+        move_t move;
+        int nr_picked = 0;
+        while (next_move(&picker, &move)) {
+            int key = move_key(move);
+            if (find_key(picked, nr_picked, key) != -1) report(board, "move picked twice");
+            if (find_key(all, nr_all, key) == -1) report(board, "illegal move picked");
+            if (nr_picked < MOVELIST_SIZE) picked[nr_picked++] = key;
+
+            /* like the search, visit the child (its move generation overwrites the pins and checkers on the board) */
+            movelist_t child;
+            init_movelist(&child);
+            do_move(board, move);
+            generate_moves(board, &child);
+            undo_move(board, move);
+        }
+        if (nr_picked != nr_all) report(board, "move picker missed moves");
+    }
+
+    /* remember the quiet moves of this node as killer candidates of the next node */
+    nr_previous_quiets = 0;
+    for (int i = 0; i < nr_all; i++) {
+        if (!(moves[i].flags & 0b1100)) previous_quiets[nr_previous_quiets++] = moves[i];
+    }
+
+    if (depth == 0) return;
+    for (int i = 0; i < nr_all; i++) {
+        do_move(board, moves[i]);
+        check_node(board, depth - 1);
+        undo_move(board, moves[i]);
+    }
+}
+
+int main(void) {
+    /* initialize boards for movegen */
+    initialize_attack_boards();
+    initialize_helper_boards();
+
+    /* initialize zobrist table */
+    initialize_zobrist_table();
+
+    /* positions with checks, pins, castling, en passant and (capture) promotions */
+    char* fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+    };
+
+    for (int i = 0; i < 2 * 64 * 64; i++) (&history[0][0][0])[i] = (int16_t) ((i * 7919) % (2 * HISTORY_MAX + 1) - HISTORY_MAX);
+
+    board_t* board = init_board();
+    for (int i = 0; i < (int) (sizeof(fens) / sizeof(fens[0])); i++) {
+        load_by_FEN(board, fens[i]);
+        check_node(board, 3);
+    }
+    free_board(board);
+
+    if (errors != 0) {
+        printf("%d errors found\n", errors);
+        exit(EXIT_FAILURE);
+    }
+    printf("move picker test passed\n");
+    return 0;
+}
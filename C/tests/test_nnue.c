@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "include/engine-core/engine.h"
+
+#define BENCH_ITERATIONS 200
+
+int errors = 0;
+
+/* positions with castling, en passant, (capture) promotions and king moves */
+char* fens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+};
+
+/* random network (kept to compute reference evaluations) */
+int16_t* weights;
+int16_t bias[NNUE_HIDDEN];
+int16_t output_weights[2 * NNUE_HIDDEN];
+int32_t output_bias;
+
+/* returns a pseudo random number in [-range, range] */
+int random_value(int range) {
+    static uint64_t state = 0x9E3779B97F4A7C15ULL;
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (int) ((state >> 33) % (2 * range + 1)) - range;
+}
+
+/* writes a network with random weights to the given file */
+void write_random_network(const char* path) {
+    weights = (int16_t*) malloc((size_t) NNUE_INPUTS * NNUE_HIDDEN * sizeof(int16_t));
+    for (size_t i = 0; i < (size_t) NNUE_INPUTS * NNUE_HIDDEN; i++) weights[i] = (int16_t) random_value(32);
+    for (int i = 0; i < NNUE_HIDDEN; i++) bias[i] = (int16_t) random_value(64);
+    for (int i = 0; i < 2 * NNUE_HIDDEN; i++) output_weights[i] = (int16_t) random_value(64);
+    output_bias = random_value(1000);
+
+    uint32_t header[4] = {NNUE_MAGIC, NNUE_VERSION, NNUE_INPUTS, NNUE_HIDDEN};
+    FILE* file = fopen(path, "wb");
+    fwrite(header, sizeof(uint32_t), 4, file);
+    fwrite(weights, sizeof(int16_t), (size_t) NNUE_INPUTS * NNUE_HIDDEN, file);
+    fwrite(bias, sizeof(int16_t), NNUE_HIDDEN, file);
+    fwrite(output_weights, sizeof(int16_t), 2 * NNUE_HIDDEN, file);
+    fwrite(&output_bias, sizeof(int32_t), 1, file);
+    fclose(file);
+}
+
+/* returns the network evaluation computed naively from the random weights (independent of the SIMD kernels) */
+int reference_eval(board_t* board) {
+    int64_t sum = output_bias;
+    for (int view = 0; view < 2; view++) {
+        player_t perspective = (view == 0) ? board->player : SWITCHSIDES(board->player);
+        int ksq = find_1st_bit(board->piece_bb[perspective == WHITE ? W_KING : B_KING]);
+        int flip = (perspective == WHITE) ? 0 : 56;
+
+        for (int i = 0; i < NNUE_HIDDEN; i++) {
+            int32_t value = bias[i];
+            for (int sq = 0; sq < 64; sq++) {
+                piece_t pc = board->playingfield[sq];
+                if (pc == NO_PIECE) continue;
+                int relative_piece = ((pc >> 3) == perspective ? 0 : 6) + (pc & 0b111);
+                int feature = (((ksq ^ flip) * 12 + relative_piece) * 64) + (sq ^ flip);
+                value += weights[(size_t) feature * NNUE_HIDDEN + i];
+            }
+            if (value < 0) value = 0;
+            if (value > NNUE_QA) value = NNUE_QA;
+            sum += value * output_weights[view * NNUE_HIDDEN + i];
+        }
+    }
+    return (int) (sum * NNUE_SCALE / (NNUE_QA * NNUE_QB));
+}
+
+/* checks the incrementally updated evaluation against the one computed from scratch on every node up to the given depth */
+void check_node(board_t* board, int depth) {
+    int eval = nnue_evaluate(board);
+    if (eval != nnue_evaluate_full(board)) {
+        if (errors++ < 10) {
+            printf("incremental evaluation %d differs from full evaluation %d\n", eval, nnue_evaluate_full(board));
+            print_board(board);
+        }
+    }
+    if (depth == 0) return;
+
+    movelist_t movelst;
+    init_movelist(&movelst);
+    generate_moves(board, &movelst);
+    for (int i = 0; i < movelst.nr_elem; i++) {
+        do_move(board, movelst.array[i]);
+        check_node(board, depth - 1);
+        undo_move(board, movelst.array[i]);
+    }
+
+    if (!is_in_check(board)) {
+        do_null_move(board);
+        check_node(board, 0);
+        undo_null_move(board);
+    }
+}
+
+/* evaluates every child of the positions, returns a checksum */
+int64_t bench_children(board_t** boards, movelist_t* moves, int nr_boards) {
+    int64_t checksum = 0;
+    for (int i = 0; i < nr_boards; i++) {
+        for (int j = 0; j < moves[i].nr_elem; j++) {
+            do_move(boards[i], moves[i].array[j]);
+            checksum += eval_board(boards[i], NULL);
+            undo_move(boards[i], moves[i].array[j]);
+        }
+    }
+    return checksum;
+}
+
+/* returns the time passed since start in ms */
+double ms_since(struct timeval start) {
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec - start.tv_sec) * 1000.0 + (now.tv_usec - start.tv_usec) / 1000.0;
+}
+
+int main(void) {
+    initialize_attack_boards();
+    initialize_helper_boards();
+    initialize_zobrist_table();
+    initialize_eval_tables();
+
+    int nr_fens = (int) (sizeof(fens) / sizeof(fens[0]));
+
+    /* (1) the loader rejects files which are not networks of the expected shape */
+    char path[] = "/tmp/test_nnue_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("could not create temporary network file\n");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    if (load_nnue(path) || nnue_net.loaded) {
+        printf("empty network file was accepted\n");
+        errors++;
+    }
+
+    /* (2) the loaded network evaluates like the naive reference */
+    write_random_network(path);
+    if (!load_nnue(path)) {
+        printf("could not load random network\n");
+        exit(EXIT_FAILURE);
+    }
+    remove(path);
+
+    board_t* board = init_board();
+    for (int i = 0; i < nr_fens; i++) {
+        load_by_FEN(board, fens[i]);
+        if (nnue_evaluate(board) != reference_eval(board)) {
+            printf("network evaluation %d differs from reference %d\n", nnue_evaluate(board), reference_eval(board));
+            print_board(board);
+            errors++;
+        }
+    }
+
+    /* (3) incremental updates agree with evaluations from scratch */
+    for (int i = 0; i < nr_fens; i++) {
+        load_by_FEN(board, fens[i]);
+        check_node(board, 3);
+    }
+
+    /* (4) outputs beyond the mate scores are clamped below them */
+    int32_t loaded_bias = nnue_net.output_bias;
+    load_by_FEN(board, fens[0]);
+    for (int sign = -1; sign <= 1; sign += 2) {
+        nnue_net.output_bias = sign * 100000000;
+        if (nnue_evaluate(board) != sign * (MATE_BOUND - 1) || nnue_evaluate_full(board) != sign * (MATE_BOUND - 1)) {
+            printf("network output %d is not clamped to %d\n", nnue_evaluate(board), sign * (MATE_BOUND - 1));
+            errors++;
+        }
+    }
+    nnue_net.output_bias = loaded_bias;
+    free_board(board);
+
+    if (errors != 0) {
+        printf("%d errors found\n", errors);
+        exit(EXIT_FAILURE);
+    }
+
+    /* benchmark: evaluate all children of the positions (like the search does) with the network and with PeSTO */
+    board_t* boards[nr_fens];
+    movelist_t moves[nr_fens];
+    int nr_evals = 0;
+    for (int i = 0; i < nr_fens; i++) {
+        boards[i] = init_board();
+        load_by_FEN(boards[i], fens[i]);
+        init_movelist(&moves[i]);
+        generate_moves(boards[i], &moves[i]);
+        nr_evals += moves[i].nr_elem;
+    }
+
+    int64_t checksum = 0;
+    struct timeval start;
+    gettimeofday(&start, 0);
+    for (int it = 0; it < BENCH_ITERATIONS; it++) checksum += bench_children(boards, moves, nr_fens);
+    double ms_nnue = ms_since(start);
+
+    unload_nnue();
+    gettimeofday(&start, 0);
+    for (int it = 0; it < BENCH_ITERATIONS; it++) checksum += bench_children(boards, moves, nr_fens);
+    double ms_pesto = ms_since(start);
+
+    printf("network: %.2fM evals/s, PeSTO: %.2fM evals/s (checksum %lld)\n",
+           nr_evals * BENCH_ITERATIONS / ms_nnue / 1000.0, nr_evals * BENCH_ITERATIONS / ms_pesto / 1000.0, (long long) checksum);
+
+    for (int i = 0; i < nr_fens; i++) free_board(boards[i]);
+    free(weights);
+
+    printf("NNUE tests passed!\n");
+    return 0;
+}
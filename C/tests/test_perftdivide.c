@@ -14,7 +14,7 @@ int main(void) {
 
     perft_divide(board, 5);
 
-    free(board);
+    free_board(board);
 
     return 0;
 }
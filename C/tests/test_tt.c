@@ -1,8 +1,184 @@
 #include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "include/engine-core/engine.h"
 
+#define STRESS_THREADS 8
+#define STRESS_KEYS 64
+#define STRESS_ITERATIONS 500000
+
 tt_t tt;
+tt_t stress_tt;
+uint64_t stress_keys[STRESS_KEYS];
+
+/* the payload of a stress test entry is derived from its key, so every read can be verified */
+move_t stress_move(uint64_t key) {
+    move_t move = {.value = 0, .from = key & 0x3F, .to = (key >> 6) & 0x3F, .flags = (key >> 12) & 0xF};
+    return move;
+}
+int8_t stress_depth(uint64_t key) { return (key >> 16) & 0x3F; }
+int32_t stress_eval(uint64_t key) { return (int32_t)((key >> 24) & 0xFFFF) - 32768; }
+int8_t stress_flags(uint64_t key) { return (key >> 40) % 3; }
+int32_t stress_static_eval(uint64_t key) { return (int32_t)((key >> 44) & 0xFFFF) - 32768; }
+
+/* checks whether a key is one of the keys used in the stress test */
+int is_stress_key(uint64_t key) {
+    for(int i = 0; i < STRESS_KEYS; i++) {
+        if(stress_keys[i] == key) return 1;
+    }
+    return 0;
+}
+
+/* results of a single stress test thread */
+typedef struct _stress_result_t {
+    uint64_t hits;              /* number of successful retrievals */
+    uint64_t torn_accepted;     /* number of retrievals which returned a corrupted entry */
+    uint64_t torn_rejected;     /* number of torn slots seen (and rejected by the xor check) */
+} stress_result_t;
+
+/* hammers the (tiny) stress table with stores and retrievals of random keys */
+void* stress_thread(void* args) {
+    stress_result_t* result = (stress_result_t*) args;
+    board_t* board = init_board();
+    uint64_t rng = (uint64_t) (uintptr_t) args | 1;
+
+    for(int i = 0; i < STRESS_ITERATIONS; i++) {
+        /* xorshift, since rand() is not thread-safe */
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+
+        /* store an entry */
+        board->hash = stress_keys[rng % STRESS_KEYS];
+        store_tt_entry(stress_tt, board, stress_move(board->hash), stress_depth(board->hash), stress_eval(board->hash), stress_flags(board->hash), stress_static_eval(board->hash));
+
+        /* retrieve an entry and verify its payload */
+        board->hash = stress_keys[(rng >> 32) % STRESS_KEYS];
+        tt_entry_t entry;
+        if(retrieve_tt_entry(stress_tt, board, &entry)) {
+            result->hits++;
+            if(!is_same_move(entry.best_move, stress_move(board->hash)) || entry.depth != stress_depth(board->hash) ||
+               entry.eval != stress_eval(board->hash) || entry.flags != stress_flags(board->hash) ||
+               entry.static_eval != stress_static_eval(board->hash)) {
+                result->torn_accepted++;
+            }
+        }
+
+        /* look at the raw slots to count how many torn entries the xor check had to reject */
+        tt_cluster_t* cluster = &stress_tt.clusters[rng % stress_tt.size];
+        for(int j = 0; j < TT_CLUSTER_SIZE; j++) {
+            uint64_t key = __atomic_load_n(&cluster->slots[j].key, __ATOMIC_RELAXED);
+            uint64_t data = __atomic_load_n(&cluster->slots[j].data, __ATOMIC_RELAXED);
+            if(key != 0ULL && !is_stress_key(key ^ data)) result->torn_rejected++;
+        }
+    }
+
+    free_board(board);
+    return NULL;
+}
+
+/* checks that entries of older searches are replaced before (even shallower) entries of the current search */
+int aging_test_tt(void) {
+    tt_t aging_tt = init_tt(2 * sizeof(tt_cluster_t));
+    board_t* boards[TT_CLUSTER_SIZE + 1];
+    move_t move = {.value = 0, .from = 8, .to = 16, .flags = 0};
+
+    /* find positions (keys) which all map to the first cluster */
+    for(int i = 0, key = 1; i < TT_CLUSTER_SIZE + 1; key++) {
+        if((((uint64_t) key * 11400714819323198485ULL) >> 63) == 0) {
+            boards[i] = init_board();
+            boards[i++]->hash = key;
+        }
+    }
+
+    /* the previous search stored deep entries (but left one slot empty) */
+    for(int i = 0; i < TT_CLUSTER_SIZE - 1; i++) store_tt_entry(aging_tt, boards[i], move, 10, 0, EXACT, TT_NO_EVAL);
+
+    /* the current search stores two shallow entries, the second one has to evict an entry of the previous search */
+    age_tt(&aging_tt);
+    age_tt(&aging_tt);
+    store_tt_entry(aging_tt, boards[TT_CLUSTER_SIZE - 1], move, 2, 0, EXACT, TT_NO_EVAL);
+    store_tt_entry(aging_tt, boards[TT_CLUSTER_SIZE], move, 1, 0, EXACT, TT_NO_EVAL);
+
+    tt_entry_t entry;
+    int old_entries_kept = 0;
+    for(int i = 0; i < TT_CLUSTER_SIZE - 1; i++) old_entries_kept += retrieve_tt_entry(aging_tt, boards[i], &entry);
+    int success = old_entries_kept == TT_CLUSTER_SIZE - 2 &&
+                  retrieve_tt_entry(aging_tt, boards[TT_CLUSTER_SIZE - 1], &entry) &&
+                  retrieve_tt_entry(aging_tt, boards[TT_CLUSTER_SIZE], &entry);
+
+    for(int i = 0; i < TT_CLUSTER_SIZE + 1; i++) free_board(boards[i]);
+    free_tt(aging_tt);
+    return success;
+}
+
+/* checks that a file-backed table keeps its entries across sessions, but only if the file is compatible */
+int persistence_test_tt(board_t* board) {
+    char path[] = "/tmp/test_tt_XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0) return 0;
+    close(fd);
+
+    move_t move = {.value = 0, .from = 12, .to = 28, .flags = DOUBLEP};
+    tt_entry_t entry;
+    int success = 1;
+
+    /* (1) first session: store an entry */
+    tt_t file_tt = init_tt_file(path, MB_TO_BYTES(1));
+    success &= (file_tt.header != NULL);
+    age_tt(&file_tt);
+    store_tt_entry(file_tt, board, move, 7, 42, EXACT, TT_NO_EVAL);
+    free_tt(file_tt);
+
+    /* (2) second session: the entry (and the generation) is still there */
+    file_tt = init_tt_file(path, MB_TO_BYTES(1));
+    success &= retrieve_tt_entry(file_tt, board, &entry) && is_same_move(entry.best_move, move) && entry.eval == 42;
+    success &= (file_tt.generation == 1);
+    free_tt(file_tt);
+
+    /* (3) a session with different zobrist keys starts with an empty table */
+    zobrist_table.seed++;
+    file_tt = init_tt_file(path, MB_TO_BYTES(1));
+    success &= !retrieve_tt_entry(file_tt, board, &entry);
+    store_tt_entry(file_tt, board, move, 7, 42, EXACT, TT_NO_EVAL);
+    free_tt(file_tt);
+    zobrist_table.seed--;
+
+    /* (4) and so does a session with a different table size */
+    file_tt = init_tt_file(path, MB_TO_BYTES(2));
+    success &= !retrieve_tt_entry(file_tt, board, &entry);
+    free_tt(file_tt);
+
+    unlink(path);
+    return success;
+}
+
+/* runs the concurrency stress test, returns the number of corrupted entries that got through */
+uint64_t stress_test_tt(void) {
+    /* a tiny table, so that threads constantly fight over the same slots */
+    stress_tt = init_tt(2 * sizeof(tt_cluster_t));
+    for(int i = 0; i < STRESS_KEYS; i++) {
+        stress_keys[i] = ((uint64_t) rand() << 32) ^ ((uint64_t) rand() << 16) ^ (uint64_t) rand();
+    }
+
+    pthread_t threads[STRESS_THREADS];
+    stress_result_t results[STRESS_THREADS] = {0};
+    for(int i = 0; i < STRESS_THREADS; i++) {
+        pthread_create(&threads[i], NULL, stress_thread, &results[i]);
+    }
+
+    stress_result_t total = {0};
+    for(int i = 0; i < STRESS_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        total.hits += results[i].hits;
+        total.torn_accepted += results[i].torn_accepted;
+        total.torn_rejected += results[i].torn_rejected;
+    }
+    free_tt(stress_tt);
+
+    printf("stress test: %d threads, %llu hits, %llu torn slots rejected, %llu torn reads accepted\n", STRESS_THREADS,
+           (unsigned long long) total.hits, (unsigned long long) total.torn_rejected, (unsigned long long) total.torn_accepted);
+    return total.torn_accepted;
+}
 
 int main(void) {
     /* seed random number generator */
@@ -21,19 +197,25 @@ int main(void) {
 
     /* check if transposition table is initialized correctly */
     for(int i = 0; i < tt.size; i++){
-        if(tt.buckets[i].always_replace.key != 0ULL || tt.buckets[i].replace_if_better.key != 0ULL){
-            printf("%sFAIL%s: transposition table is not initialized correctlly \n", Color_WHITE, Color_END);
-            exit(EXIT_FAILURE);  
-        } 
+        for(int j = 0; j < TT_CLUSTER_SIZE; j++){
+            if(tt.clusters[i].slots[j].key != 0ULL || tt.clusters[i].slots[j].data != 0ULL){
+                printf("%sFAIL%s: transposition table is not initialized correctlly \n", Color_WHITE, Color_END);
+                exit(EXIT_FAILURE);  
+            } 
+        }
     }
-    printf("%sSUCCESS%s: transposition table is initialized correctly - size %d (%dMb)) - bits %d\n", Color_WHITE, Color_END, tt.size, (int) BYTES_TO_MB(tt.size*sizeof(tt_bucket_t)), tt.no_bits);
+    if((uintptr_t) tt.clusters % CACHE_LINE_SIZE != 0){
+        printf("%sFAIL%s: transposition table clusters are not aligned to cache lines\n", Color_WHITE, Color_END);
+        exit(EXIT_FAILURE);
+    }
+    printf("%sSUCCESS%s: transposition table is initialized correctly - size %d (%dMb)) - bits %d\n", Color_WHITE, Color_END, tt.size, (int) BYTES_TO_MB(tt.size*sizeof(tt_cluster_t)), tt.no_bits);
 
 
     /* check if RETREIVE and STORE are working correctly */
 
     /* (1) check if entry is NULL for board for which no entry should exist */
-    tt_entry_t* entry_null = retrieve_tt_entry(tt, board);
-    if(entry_null == NULL){
+    tt_entry_t entry;
+    if(!retrieve_tt_entry(tt, board, &entry)){
         printf("%sSUCCESS%s: no entry for board\n", Color_WHITE, Color_END);
     } else {
         printf("%sFAIL%s: entry for board\n",Color_WHITE, Color_END);
@@ -43,11 +225,10 @@ int main(void) {
    
     /* add entry for board (with 'move_one' as best move) to transposition table */
     move_t move_one = {.value = 0, .from = 8, .to = 16, .flags = 0};
-    store_tt_entry(tt, board, move_one, 5, 100, EXACT);
+    store_tt_entry(tt, board, move_one, 5, 100, EXACT, -57);
 
     /* (2.1) check if we find entry for board in transposition table */
-    tt_entry_t* entry = retrieve_tt_entry(tt, board);
-    if(entry != NULL && is_same_move(entry->best_move, move_one) && entry->depth == 5 && entry->eval == 100 && entry->flags == EXACT){
+    if(retrieve_tt_entry(tt, board, &entry) && is_same_move(entry.best_move, move_one) && entry.depth == 5 && entry.eval == 100 && entry.flags == EXACT && entry.static_eval == -57){
         printf("%sSUCCESS%s: test 1: entry is in transposition table\n", Color_WHITE, Color_END);
     } else {
         printf("%sFAIL%s: test 1: entry is not in transposition table\n", Color_WHITE, Color_END);
@@ -56,12 +237,11 @@ int main(void) {
 
     /* add entry for board (with 'move_two' as best move) to transposition table */
     move_t move_two = {.value = 0, .from = 8, .to = 16, .flags = 1};
-    store_tt_entry(tt, board, move_two, 4, 200, LOWERBOUND);
+    store_tt_entry(tt, board, move_two, 4, 200, LOWERBOUND, -57);
 
     /* (2.2) check if we find entry for board in transposition table */
     /* (2.2) AND! that we retrieve move_one since it has higher depth */
-    entry = retrieve_tt_entry(tt, board);
-    if(entry != NULL && is_same_move(entry->best_move, move_one) && entry->depth == 5 && entry->eval == 100 && entry->flags == EXACT){
+    if(retrieve_tt_entry(tt, board, &entry) && is_same_move(entry.best_move, move_one) && entry.depth == 5 && entry.eval == 100 && entry.flags == EXACT){
         printf("%sSUCCESS%s: test 2: entry is in transposition table\n", Color_WHITE, Color_END);
     } else {
         printf("%sFAIL%s: test 2: entry is not in transposition table\n", Color_WHITE, Color_END);
@@ -70,18 +250,55 @@ int main(void) {
 
     /* add entry for board (with 'move_three' as best move) to transposition table */
     move_t move_three = {.value = 0, .from = 8, .to = 16, .flags = 2};
-    store_tt_entry(tt, board, move_three, 6, 300, UPPERBOUND);
+    store_tt_entry(tt, board, move_three, 6, 300, UPPERBOUND, TT_NO_EVAL);
     
     
     /* (2.3) check if we find entry for board in transposition table */
     /* (2.3) AND! that we retrieve move_three since it has higher depth */
-    entry = retrieve_tt_entry(tt, board);
-    if(entry != NULL && is_same_move(entry->best_move, move_three) && entry->depth == 6 && entry->eval == 300 && entry->flags == UPPERBOUND){
+    if(retrieve_tt_entry(tt, board, &entry) && is_same_move(entry.best_move, move_three) && entry.depth == 6 && entry.eval == 300 && entry.flags == UPPERBOUND && entry.static_eval == TT_NO_EVAL){
         printf("%sSUCCESS%s: test 3: entry is in transposition table\n", Color_WHITE, Color_END);
     } else {
         printf("%sFAIL%s: test 3: entry is not in transposition table\n", Color_WHITE, Color_END);
         exit(EXIT_FAILURE);
     }
 
+    /* (2.4) check that an entry stored under the key of a search without a move (singular extensions) */
+    /* (2.4) is kept apart from the entry of the board */
+    uint64_t excluded_key = excluded_move_hash(board->hash, move_three);
+    move_t move_four = {.value = 0, .from = 9, .to = 17, .flags = 0};
+    store_tt_entry_by_key(tt, excluded_key, move_four, 7, -400, UPPERBOUND, TT_NO_EVAL);
+    if(excluded_key != board->hash && excluded_key != excluded_move_hash(board->hash, move_two) &&
+       retrieve_tt_entry_by_key(tt, excluded_key, &entry) && is_same_move(entry.best_move, move_four) && entry.eval == -400 &&
+       retrieve_tt_entry(tt, board, &entry) && is_same_move(entry.best_move, move_three) && entry.eval == 300){
+        printf("%sSUCCESS%s: test 4: entry without excluded move is kept apart\n", Color_WHITE, Color_END);
+    } else {
+        printf("%sFAIL%s: test 4: entry without excluded move is not kept apart\n", Color_WHITE, Color_END);
+        exit(EXIT_FAILURE);
+    }
+
+    /* (3) check that entries of older searches are evicted first */
+    if(aging_test_tt()){
+        printf("%sSUCCESS%s: entries of older searches are replaced first\n", Color_WHITE, Color_END);
+    } else {
+        printf("%sFAIL%s: entries of older searches are not replaced first\n", Color_WHITE, Color_END);
+        exit(EXIT_FAILURE);
+    }
+
+    /* (4) check that a file-backed table persists its entries */
+    if(persistence_test_tt(board)){
+        printf("%sSUCCESS%s: file-backed table persists its entries\n", Color_WHITE, Color_END);
+    } else {
+        printf("%sFAIL%s: file-backed table does not persist its entries correctly\n", Color_WHITE, Color_END);
+        exit(EXIT_FAILURE);
+    }
+
+    /* (5) check that concurrent stores and retrievals never hand out a corrupted entry */
+    if(stress_test_tt() == 0){
+        printf("%sSUCCESS%s: no torn reads got through\n", Color_WHITE, Color_END);
+    } else {
+        printf("%sFAIL%s: torn reads got through\n", Color_WHITE, Color_END);
+        exit(EXIT_FAILURE);
+    }
+
     free_board(board);
 }
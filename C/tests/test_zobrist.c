@@ -0,0 +1,65 @@
+#include <stdio.h>
+
+#include "include/engine-core/engine.h"
+
+int mismatches = 0;
+
+/* checks for every move up to the given depth if the precalculated hash equals the hash after executing the move */
+void check_hash_after_move(board_t* board, int depth) {
+    if (depth == 0) return;
+
+    movelist_t movelst;
+    init_movelist(&movelst);
+    generate_moves(board, &movelst);
+
+    while (has_next(&movelst)) {
+        move_t move = pick_next(&movelst);
+        uint64_t expected_hash = hash_after_move(board, move);
+
+        do_move(board, move);
+        if (board->hash != expected_hash || board->hash != calculate_zobrist_hash(board) ||
+            board->pawn_hash != calculate_pawn_hash(board)) {
+            if (mismatches++ < 10) {
+                printf("hash mismatch after ");
+                print_LAN_move(move, SWITCHSIDES(board->player));
+                printf("\n");
+                print_board(board);
+            }
+        }
+        check_hash_after_move(board, depth - 1);
+        undo_move(board, move);
+    }
+}
+
+int main(void) {
+    /* initialize boards for movegen */
+    initialize_attack_boards();
+    initialize_helper_boards();
+
+    /* initialize zobrist table */
+    initialize_zobrist_table();
+
+    /* positions with castling, en passant and (capture) promotions */
+    char* fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+    };
+
+    board_t* board = init_board();
+    for (int i = 0; i < (int) (sizeof(fens) / sizeof(fens[0])); i++) {
+        load_by_FEN(board, fens[i]);
+        check_hash_after_move(board, 3);
+    }
+    free_board(board);
+
+    if (mismatches != 0) {
+        printf("%d hash mismatches found\n", mismatches);
+        exit(EXIT_FAILURE);
+    }
+    printf("hash after move tests passed!\n");
+    return 0;
+}